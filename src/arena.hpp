@@ -0,0 +1,76 @@
+#ifndef ___ARENA_FOR_BULLETHELL_HPP__
+#define ___ARENA_FOR_BULLETHELL_HPP__
+
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+/**
+ * bump allocator for the scratch arrays of one simulation phase.
+ *
+ * allocate() hands out consecutive pieces of a block and reset() takes them all
+ * back at once. When a phase needed more than one block, reset() replaces them
+ * with a single block as large as all of them, so once the arena has grown to
+ * what a tick needs, ticks do not allocate at all.
+ *
+ * Only trivial types - nothing is constructed or destroyed. Not thread safe, the
+ * arrays are allocated before the parallel loops which use them.
+ * */
+class frame_arena_c
+{
+public:
+    /// n uninitialized values, valid until the next reset()
+    template <typename T>
+    T* allocate(size_t n)
+    {
+        static_assert(std::is_trivially_copyable<T>::value && std::is_trivially_destructible<T>::value, "arena values are not constructed");
+        static_assert(alignof(T) <= alignof(std::max_align_t), "blocks are aligned for any standard type");
+        size_t at = (used + alignof(T) - 1) / alignof(T) * alignof(T);
+        if (blocks.empty() || (at + n * sizeof(T) > blocks.back().size())) {
+            size_t size = blocks.empty() ? min_block : blocks.back().size() * 2;
+            blocks.emplace_back(std::max(size, n * sizeof(T)));
+            at = 0;
+        }
+        used = at + n * sizeof(T);
+        return reinterpret_cast<T*>(blocks.back().data() + at);
+    }
+
+    /// frees everything allocated since the last reset
+    void reset()
+    {
+        if (blocks.size() > 1) {
+            size_t total = 0;
+            for (auto& b : blocks) total += b.size();
+            blocks.clear();
+            blocks.emplace_back(total);
+        }
+        used = 0;
+    }
+
+    size_t capacity() const
+    {
+        size_t total = 0;
+        for (auto& b : blocks) total += b.size();
+        return total;
+    }
+
+private:
+    static constexpr size_t min_block = 64 * 1024;
+
+    class block_c
+    {
+    public:
+        explicit block_c(size_t size_) : words((size_ + sizeof(std::max_align_t) - 1) / sizeof(std::max_align_t)) {}
+        std::byte* data() { return reinterpret_cast<std::byte*>(words.data()); }
+        size_t size() const { return words.size() * sizeof(std::max_align_t); }
+
+    private:
+        std::vector<std::max_align_t> words;
+    };
+
+    std::vector<block_c> blocks;
+    size_t used = 0;
+};
+
+#endif
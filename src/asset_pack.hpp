@@ -0,0 +1,200 @@
+#ifndef ___ASSET_PACK_FOR_BULLETHELL_HPP__
+#define ___ASSET_PACK_FOR_BULLETHELL_HPP__
+
+#include "sectioned_file.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/**
+ * the images of the game baked by gotybake into one file, so the game starts
+ * without decoding any PNG.
+ *
+ * data/assets.txt lists the images: "sprite <name> <file>" and "font <name> <file>"
+ * for 16 x 16 glyph sheets, files relative to the list.
+ *
+ * The pack is laid out like snapshots: an asset_pack_header_c followed by sections,
+ * each one array of fixed size records starting at a 64 byte aligned offset. The
+ * atlas is stored decoded (RGBA32, row after row) and is uploaded straight from the
+ * mapped file. Font sheets which are another sheet filled with one color are not
+ * stored: they are drawn from a white mask of that sheet, tinted with the color.
+ * Numbers are little endian, as on every platform the game runs on.
+ * */
+enum asset_pack_section_e : uint32_t {
+    ASSET_PACK_SPRITE_NAMES = 0, // zero terminated strings, record size 1
+    ASSET_PACK_SPRITES,
+    ASSET_PACK_FONT_NAMES,
+    ASSET_PACK_FONTS,
+    ASSET_PACK_PIXELS, // the atlas, 4 bytes per pixel
+    ASSET_PACK_SECTION_COUNT
+};
+
+class asset_pack_section_c
+{
+public:
+    uint64_t offset;
+    uint64_t count;
+    uint32_t record_size;
+    uint32_t reserved;
+};
+
+class asset_pack_header_c
+{
+public:
+    char magic[8]; // "GOTYPAK"
+    uint32_t version;
+    uint32_t section_count;
+    uint32_t atlas_width;
+    uint32_t atlas_height;
+    asset_pack_section_c sections[ASSET_PACK_SECTION_COUNT];
+};
+
+/// where a sprite is in the atlas
+class asset_region_c
+{
+public:
+    int32_t x, y, w, h;
+};
+
+class asset_pack_font_c
+{
+public:
+    uint32_t sheet; // index of the sprite with the glyphs
+    uint16_t glyph_w;
+    uint16_t glyph_h;
+    uint8_t tint[4]; // rgba the glyphs are multiplied with
+};
+
+static const uint32_t asset_pack_version = 1;
+inline const char asset_pack_magic[8] = "GOTYPAK";
+
+enum asset_kind_e {
+    ASSET_SPRITE = 0,
+    ASSET_FONT,
+};
+
+/// one line of the asset list
+class asset_c
+{
+public:
+    asset_kind_e kind;
+    std::string name;
+    std::string file; // with the directory of the list
+};
+
+/**
+ * reads the asset list, false if it can not be read or has a line which is not an asset
+ * */
+inline bool load_asset_list(const std::string& file_name, std::vector<asset_c>& assets)
+{
+    std::ifstream file(file_name);
+    if (!file) return false;
+    auto slash = file_name.find_last_of('/');
+    std::string directory = (slash == std::string::npos) ? "" : file_name.substr(0, slash + 1);
+    for (std::string line; std::getline(file, line);) {
+        std::istringstream ss(line);
+        std::string kind, name, image;
+        if (!(ss >> kind) || kind[0] == '#') continue;
+        if (!(ss >> name >> image)) return false;
+        if (kind == "sprite") assets.push_back({ASSET_SPRITE, name, directory + image});
+        else if (kind == "font") assets.push_back({ASSET_FONT, name, directory + image});
+        else return false;
+    }
+    return true;
+}
+
+/**
+ * places images of the given sizes (x, y are ignored) into rows of an atlas
+ * atlas_width wide, tallest first, with 1 pixel of padding around every image.
+ * Returns the height of the atlas.
+ * */
+inline int pack_shelves(std::vector<asset_region_c>& regions, int atlas_width)
+{
+    std::vector<size_t> order(regions.size());
+    for (size_t i = 0; i < order.size(); i++) order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](auto a, auto b) { return regions[a].h > regions[b].h; });
+
+    int x = 0, y = 0, row_height = 0;
+    for (auto i : order) {
+        auto& r = regions[i];
+        if (x + r.w + 1 > atlas_width) {
+            x = 0;
+            y += row_height + 1;
+            row_height = 0;
+        }
+        r.x = x;
+        r.y = y;
+        x += r.w + 1;
+        row_height = std::max(row_height, r.h);
+    }
+    return y + row_height;
+}
+
+/**
+ * a baked pack mapped into memory - the pixels and records point into the file
+ * and stay valid as long as the pack
+ * */
+class asset_pack_c
+{
+public:
+    int width = 0;
+    int height = 0;
+    const uint8_t* pixels = nullptr;
+    std::vector<std::string> sprite_names;
+    const asset_region_c* sprites = nullptr; // one for every name
+    std::vector<std::string> font_names;
+    const asset_pack_font_c* fonts = nullptr;
+
+    /// false if the file is missing or is not a valid pack of this version
+    bool open(const std::string& file_name)
+    {
+        auto m = std::make_unique<mapped_file_c>(file_name);
+        if (!m->data || m->size < sizeof(asset_pack_header_c)) return false;
+        asset_pack_header_c h;
+        std::memcpy(&h, m->data, sizeof(h));
+        if (std::memcmp(h.magic, asset_pack_magic, sizeof(asset_pack_magic)) != 0) return false;
+        if (h.version != asset_pack_version || h.section_count != ASSET_PACK_SECTION_COUNT) return false;
+
+        auto sprite_section = section_records<char>(*m, h, ASSET_PACK_SPRITE_NAMES);
+        auto font_section = section_records<char>(*m, h, ASSET_PACK_FONT_NAMES);
+        auto sprite_records = section_records<asset_region_c>(*m, h, ASSET_PACK_SPRITES);
+        auto font_records = section_records<asset_pack_font_c>(*m, h, ASSET_PACK_FONTS);
+        auto pixel_records = section_records<uint32_t>(*m, h, ASSET_PACK_PIXELS);
+        if (!sprite_section || !font_section || !sprite_records || !font_records || !pixel_records) return false;
+        if (h.sections[ASSET_PACK_PIXELS].count != uint64_t(h.atlas_width) * h.atlas_height) return false;
+
+        std::vector<std::string> sprite_list, font_list;
+        if (!section_names(sprite_section, h.sections[ASSET_PACK_SPRITE_NAMES].count, sprite_list)) return false;
+        if (!section_names(font_section, h.sections[ASSET_PACK_FONT_NAMES].count, font_list)) return false;
+        if (sprite_list.size() != h.sections[ASSET_PACK_SPRITES].count) return false;
+        if (font_list.size() != h.sections[ASSET_PACK_FONTS].count) return false;
+        for (size_t i = 0; i < sprite_list.size(); i++) {
+            auto& r = sprite_records[i];
+            if (r.x < 0 || r.y < 0 || r.w < 0 || r.h < 0 || r.x + r.w > (int64_t)h.atlas_width ||
+                r.y + r.h > (int64_t)h.atlas_height) return false;
+        }
+        for (size_t i = 0; i < font_list.size(); i++) {
+            if (font_records[i].sheet >= sprite_list.size()) return false;
+        }
+
+        width = h.atlas_width;
+        height = h.atlas_height;
+        pixels = (const uint8_t*)pixel_records;
+        sprite_names = std::move(sprite_list);
+        sprites = sprite_records;
+        font_names = std::move(font_list);
+        fonts = font_records;
+        file = std::move(m);
+        return true;
+    }
+
+private:
+    std::unique_ptr<mapped_file_c> file;
+};
+
+#endif
@@ -0,0 +1,166 @@
+#include "asset_pack.hpp"
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/**
+ * bakes the images of the asset list into one pack the game maps and uploads
+ * without decoding anything
+ *
+ * usage: gotybake list pack
+ *   exits with 1 if an image can not be decoded or the pack can not be written
+ * */
+
+static_assert(std::is_trivially_copyable<asset_pack_header_c>::value);
+static_assert(std::is_trivially_copyable<asset_region_c>::value);
+static_assert(std::is_trivially_copyable<asset_pack_font_c>::value);
+
+/// decoded image, RGBA32 without padding
+class image_c
+{
+public:
+    int w = 0;
+    int h = 0;
+    std::vector<uint8_t> rgba;
+};
+
+static bool decode(const std::string& file_name, image_c& image)
+{
+    SDL_Surface* loaded = IMG_Load(file_name.c_str());
+    if (!loaded) return false;
+    SDL_Surface* s = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_RGBA32, 0);
+    SDL_FreeSurface(loaded);
+    if (!s) return false;
+    image.w = s->w;
+    image.h = s->h;
+    image.rgba.resize(size_t(s->w) * s->h * 4);
+    SDL_LockSurface(s);
+    for (int y = 0; y < s->h; y++) std::memcpy(&image.rgba[size_t(y) * s->w * 4], (const uint8_t*)s->pixels + size_t(y) * s->pitch, s->w * 4);
+    SDL_UnlockSurface(s);
+    SDL_FreeSurface(s);
+    return true;
+}
+
+/**
+ * true if image is sheet with every visible pixel of one color (the color is
+ * returned in rgb) - then it is drawn as the white mask of sheet tinted with it
+ * */
+static bool filled_from(const image_c& image, const image_c& sheet, uint8_t rgb[3])
+{
+    if (image.w != sheet.w || image.h != sheet.h) return false;
+    bool first = true;
+    for (size_t i = 0; i < image.rgba.size(); i += 4) {
+        if (image.rgba[i + 3] != sheet.rgba[i + 3]) return false;
+        if (image.rgba[i + 3] == 0) continue;
+        if (first) std::memcpy(rgb, &image.rgba[i], 3);
+        else if (std::memcmp(rgb, &image.rgba[i], 3) != 0) return false;
+        first = false;
+    }
+    return !first;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3) {
+        std::cerr << "usage: " << argv[0] << " list pack" << std::endl;
+        return 1;
+    }
+    std::vector<asset_c> assets;
+    if (!load_asset_list(argv[1], assets)) {
+        std::cerr << argv[1] << ": not an asset list" << std::endl;
+        return 1;
+    }
+
+    // images which go into the atlas, with their sprite names
+    std::vector<image_c> images;
+    std::vector<std::string> sprite_names;
+    std::vector<std::string> font_names;
+    std::vector<asset_pack_font_c> fonts;
+    std::vector<size_t> font_images; // image of every font, before masks are made
+    std::vector<int> masks;          // white mask of every image, -1 when not made yet
+    for (auto& a : assets) {
+        image_c image;
+        if (!decode(a.file, image)) {
+            std::cerr << a.file << ": " << SDL_GetError() << std::endl;
+            return 1;
+        }
+        if (a.kind == ASSET_SPRITE) {
+            images.push_back(std::move(image));
+            sprite_names.push_back(a.name);
+            masks.push_back(-1);
+            continue;
+        }
+
+        asset_pack_font_c font = {0, uint16_t(image.w / 16), uint16_t(image.h / 16), {255, 255, 255, 255}};
+        bool tinted = false;
+        for (auto f : font_images) {
+            if (!filled_from(image, images[f], font.tint)) {
+                std::memset(font.tint, 255, 3);
+                continue;
+            }
+            if (masks[f] < 0) {
+                image_c mask = images[f];
+                for (size_t i = 0; i < mask.rgba.size(); i += 4) std::memset(&mask.rgba[i], 255, 3);
+                masks[f] = images.size();
+                images.push_back(std::move(mask));
+                sprite_names.push_back(sprite_names[f] + ".mask");
+                masks.push_back(-1);
+            }
+            font.sheet = masks[f];
+            tinted = true;
+            break;
+        }
+        if (!tinted) {
+            font.sheet = images.size();
+            font_images.push_back(images.size());
+            images.push_back(std::move(image));
+            sprite_names.push_back(a.name);
+            masks.push_back(-1);
+        }
+        fonts.push_back(font);
+        font_names.push_back(a.name);
+    }
+
+    // rows as wide as the game's atlas, the texture only as wide as they are filled
+    std::vector<asset_region_c> regions;
+    for (auto& image : images) regions.push_back({0, 0, image.w, image.h});
+    int atlas_height = pack_shelves(regions, 512);
+    int atlas_width = 1;
+    for (auto& r : regions) atlas_width = std::max(atlas_width, r.x + r.w);
+    std::vector<uint32_t> pixels(size_t(atlas_width) * atlas_height, 0);
+    for (size_t i = 0; i < images.size(); i++) {
+        auto& r = regions[i];
+        for (int y = 0; y < r.h; y++) {
+            std::memcpy(&pixels[size_t(r.y + y) * atlas_width + r.x], &images[i].rgba[size_t(y) * r.w * 4], r.w * 4);
+        }
+    }
+
+    sectioned_writer_c<asset_pack_header_c> w;
+    std::memcpy(w.header.magic, asset_pack_magic, sizeof(asset_pack_magic));
+    w.header.version = asset_pack_version;
+    w.header.section_count = ASSET_PACK_SECTION_COUNT;
+    w.header.atlas_width = atlas_width;
+    w.header.atlas_height = atlas_height;
+    std::string sprite_text, font_text;
+    for (auto& n : sprite_names) sprite_text.append(n.c_str(), n.size() + 1);
+    for (auto& n : font_names) font_text.append(n.c_str(), n.size() + 1);
+    w.section(ASSET_PACK_SPRITE_NAMES, sprite_text.data(), sprite_text.size());
+    w.section(ASSET_PACK_FONT_NAMES, font_text.data(), font_text.size());
+    w.section(ASSET_PACK_SPRITES, regions.data(), regions.size());
+    w.section(ASSET_PACK_FONTS, fonts.data(), fonts.size());
+    w.section(ASSET_PACK_PIXELS, pixels.data(), pixels.size());
+
+    if (!w.write(argv[2])) {
+        std::cerr << argv[2] << ": can not write the pack" << std::endl;
+        return 1;
+    }
+    std::cout << argv[2] << ": " << sprite_names.size() << " sprites, " << fonts.size() << " fonts, "
+              << atlas_width << " x " << atlas_height << " atlas, " << w.offset << " bytes" << std::endl;
+    return 0;
+}
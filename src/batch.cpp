@@ -0,0 +1,275 @@
+#include "simulation.hpp"
+#include "work_pool.hpp"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * runs many independent matches played by bots, for balancing sweeps and for
+ * training scripted agents
+ *
+ * usage: gotybatch [--worlds n] [--ticks n] [--threads n] [--emit-delay list] [--friction list]
+ *                  [--jump-time list] [--sample ticks] [--out file] [--health file]
+ *   every combination of the listed values (comma separated, not negative) is played by --worlds
+ *   worlds with different bot seeds. --emit-delay is set on every emitter,
+ *   --friction and --jump-time on every player; without them the level values are
+ *   kept. --out writes the results of every world and player as CSV, --health the
+ *   health of the players every --sample ticks.
+ * */
+
+/**
+ * scripted player - walks one way for a while, jumps now and then and keeps
+ * shooting. Every world has its own seed, so the worlds play differently but a
+ * world plays the same every run.
+ * */
+class bot_c
+{
+public:
+    explicit bot_c(uint64_t seed) : state(seed * 0x9e3779b97f4a7c15ull + 1) {}
+
+    uint32_t intents(const player_c& p)
+    {
+        if (hold == 0) {
+            move = std::array<uint32_t, 3>{0, INTENT_LEFT, INTENT_RIGHT}[random(3)];
+            hold = 20 + random(80);
+        }
+        hold--;
+        uint32_t i = move | INTENT_SHOOT;
+        if (p.on_ground && random(40) == 0) jump = 16;
+        if (jump) {
+            i |= INTENT_UP;
+            jump--;
+        }
+        if (random(8) == 0) i |= random(2) ? INTENT_GUN_UP : INTENT_GUN_DOWN;
+        if (p.position[1] > 40) i |= INTENT_WARP_SPAWN;
+        return i;
+    }
+
+private:
+    uint64_t state;
+    uint32_t move = 0;
+    uint32_t hold = 0;
+    uint32_t jump = 0;
+
+    uint32_t random(uint32_t n)
+    {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        return (state >> 33) % n;
+    }
+};
+
+/// values of the swept parameters, NAN keeps the value of the level
+class batch_config_c
+{
+public:
+    double emit_delay = NAN;
+    double friction = NAN;
+    double jump_time = NAN;
+};
+
+/// what happened to every player of one world
+class world_result_c
+{
+public:
+    size_t config;
+    uint64_t seed;
+    std::vector<uint32_t> hits;
+    std::vector<double> mean_health;
+    std::vector<double> final_health;
+    /// health of every player, every sample_ticks - player after player
+    std::vector<float> health;
+};
+
+/// comma separated numbers, none of them negative
+static bool parse_list(const std::string& text, std::vector<double>& values)
+{
+    std::istringstream ss(text);
+    for (std::string item; std::getline(ss, item, ',');) {
+        try {
+            size_t used;
+            double value = std::stod(item, &used);
+            if (used != item.size() || !std::isfinite(value) || value < 0) return false;
+            values.push_back(value);
+        }
+        catch (const std::exception&) {
+            return false;
+        }
+    }
+    return !values.empty();
+}
+
+/// a whole number of at least 1
+static bool parse_count(const std::string& text, long& value)
+{
+    try {
+        size_t used;
+        value = std::stol(text, &used);
+        return used == text.size() && value >= 1;
+    }
+    catch (const std::exception&) {
+        return false;
+    }
+}
+
+static std::string value_text(double v)
+{
+    if (std::isnan(v)) return "-";
+    std::ostringstream ss;
+    ss << v;
+    return ss.str();
+}
+
+int main(int argc, char** argv)
+{
+    using namespace std::chrono;
+    long worlds_per_config = 100;
+    long ticks = 4000;
+    long sample_ticks = 100;
+    long threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<double> emit_delays, frictions, jump_times;
+    std::string out_file, health_file;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool ok = true;
+        if (i + 1 == argc) ok = false;
+        else if (arg == "--worlds") ok = parse_count(argv[++i], worlds_per_config);
+        else if (arg == "--ticks") ok = parse_count(argv[++i], ticks);
+        else if (arg == "--threads") ok = parse_count(argv[++i], threads) && threads <= 4096;
+        else if (arg == "--sample") ok = parse_count(argv[++i], sample_ticks);
+        else if (arg == "--emit-delay") ok = parse_list(argv[++i], emit_delays);
+        else if (arg == "--friction") ok = parse_list(argv[++i], frictions);
+        else if (arg == "--jump-time") ok = parse_list(argv[++i], jump_times);
+        else if (arg == "--out") out_file = argv[++i];
+        else if (arg == "--health") health_file = argv[++i];
+        else ok = false;
+        if (!ok) {
+            std::cerr << argv[0] << ": bad argument " << arg << std::endl;
+            return 1;
+        }
+    }
+    if (emit_delays.empty()) emit_delays.push_back(NAN);
+    if (frictions.empty()) frictions.push_back(NAN);
+    if (jump_times.empty()) jump_times.push_back(NAN);
+
+    std::vector<batch_config_c> configs;
+    for (auto e : emit_delays) {
+        for (auto f : frictions) {
+            for (auto j : jump_times) configs.push_back({e, f, j});
+        }
+    }
+
+    // every world starts as a copy of this one
+    world_c prototype;
+    initialize_world(prototype);
+
+    size_t world_count = configs.size() * worlds_per_config;
+    size_t players = prototype.players.size();
+    size_t samples = ticks / sample_ticks;
+    std::vector<world_result_c> results(world_count);
+    work_pool_c pool(static_cast<int>(threads));
+    // one world per thread, assigning the prototype reuses its memory
+    std::vector<world_c> thread_worlds(pool.size());
+
+    steady_clock::time_point start = steady_clock::now();
+    pool.run(world_count, [&](size_t w, int t) {
+        auto& r = results[w];
+        r.config = w / worlds_per_config;
+        r.seed = w % worlds_per_config;
+        auto& config = configs[r.config];
+        auto& game = thread_worlds[t];
+        game = prototype;
+        for (auto& e : game.emitters) {
+            if (!std::isnan(config.emit_delay)) e.emit_delay = config.emit_delay;
+        }
+        for (auto& p : game.players) {
+            if (!std::isnan(config.friction)) p.friction = config.friction;
+            if (!std::isnan(config.jump_time)) p.jump_time = p.jump_time_left = config.jump_time;
+        }
+
+        std::vector<bot_c> bots;
+        for (size_t p = 0; p < players; p++) bots.emplace_back(r.seed * players + p);
+        std::vector<uint32_t> intents(players);
+        std::vector<double> health_sum(players, 0);
+        r.health.resize(players * samples);
+        for (long tick = 0; tick < ticks; tick++) {
+            for (size_t p = 0; p < players; p++) intents[p] = bots[p].intents(game.players[p]);
+            apply_intents(game, intents);
+            process_events(game);
+            process_physics(game);
+            for (size_t p = 0; p < players; p++) health_sum[p] += double(game.players[p].health);
+            if ((tick + 1) % sample_ticks == 0) {
+                size_t s = (tick + 1) / sample_ticks - 1;
+                for (size_t p = 0; p < players; p++) r.health[p * samples + s] = double(game.players[p].health);
+            }
+        }
+        for (size_t p = 0; p < players; p++) {
+            auto& player = game.players[p];
+            r.hits.push_back(player.hits_taken);
+            r.mean_health.push_back(health_sum[p] / std::max(1l, ticks));
+            r.final_health.push_back(double(player.health));
+        }
+    });
+    double seconds = duration<double>(steady_clock::now() - start).count();
+
+    // averages of every combination, over its worlds and players
+    std::printf("%-10s %-10s %-10s %8s %12s %12s\n", "emit_delay", "friction", "jump_time", "worlds", "hits", "mean health");
+    for (size_t c = 0; c < configs.size(); c++) {
+        double hits = 0, health = 0, n = 0;
+        for (auto& r : results) {
+            if (r.config != c) continue;
+            for (size_t p = 0; p < players; p++, n++) {
+                hits += r.hits[p];
+                health += r.mean_health[p];
+            }
+        }
+        n = std::max(n, 1.0);
+        std::printf("%-10s %-10s %-10s %8ld %12.2f %12.2f\n", value_text(configs[c].emit_delay).c_str(),
+            value_text(configs[c].friction).c_str(), value_text(configs[c].jump_time).c_str(), worlds_per_config,
+            hits / n, health / n);
+    }
+    std::printf("%zu worlds x %ld ticks on %d threads in %.3f s: %.0f world-ticks/s (%zu stolen)\n", world_count, ticks,
+        pool.size(), seconds, world_count * ticks / seconds, pool.steals());
+
+    if (out_file.size()) {
+        std::ofstream out(out_file);
+        out << "world,emit_delay,friction,jump_time,seed,player,hits,mean_health,final_health\n";
+        for (size_t w = 0; w < results.size(); w++) {
+            auto& r = results[w];
+            auto& config = configs[r.config];
+            for (size_t p = 0; p < players; p++) {
+                out << w << "," << value_text(config.emit_delay) << "," << value_text(config.friction) << ","
+                    << value_text(config.jump_time) << "," << r.seed << "," << p << "," << r.hits[p] << ","
+                    << r.mean_health[p] << "," << r.final_health[p] << "\n";
+            }
+        }
+        if (!out) {
+            std::cerr << out_file << ": can not write the results" << std::endl;
+            return 1;
+        }
+    }
+    if (health_file.size()) {
+        std::ofstream out(health_file);
+        out << "world,tick,player,health\n";
+        for (size_t w = 0; w < results.size(); w++) {
+            for (size_t p = 0; p < players; p++) {
+                for (size_t s = 0; s < samples; s++) {
+                    out << w << "," << (s + 1) * sample_ticks << "," << p << "," << results[w].health[p * samples + s] << "\n";
+                }
+            }
+        }
+        if (!out) {
+            std::cerr << health_file << ": can not write the health" << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
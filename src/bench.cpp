@@ -0,0 +1,208 @@
+#include "simulation.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <string>
+#include <vector>
+
+/**
+ * benchmarks of the simulation hot paths
+ *
+ * usage: gotybench [filter]
+ *   runs the scenarios whose name contains filter (all by default)
+ * */
+
+// ALLOCATION COUNTING
+static std::atomic<uint64_t> allocation_count{0};
+
+void* operator new(std::size_t n)
+{
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t n) { return operator new(n); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+/// small deterministic generator, so every run uses the same scenario
+class lcg_c
+{
+public:
+    uint64_t state;
+    lcg_c(uint64_t seed) : state(seed) {}
+    double operator()(double a, double b)
+    {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        return a + (b - a) * ((state >> 11) * (1.0 / 9007199254740992.0));
+    }
+};
+
+class phase_c
+{
+public:
+    std::string name;
+    double seconds = 0;
+    double entity_ticks = 0;
+    uint64_t allocations = 0;
+    long ticks = 0;
+
+    template <typename F>
+    void measure(size_t entities, F f)
+    {
+        using namespace std::chrono;
+        uint64_t a0 = allocation_count.load();
+        steady_clock::time_point t0 = steady_clock::now();
+        f();
+        seconds += duration<double>(steady_clock::now() - t0).count();
+        allocations += allocation_count.load() - a0;
+        entity_ticks += entities;
+        ticks++;
+    }
+
+    void report(const std::string& scenario) const
+    {
+        if (entity_ticks == 0) return;
+        std::printf("%-26s %-14s %10.0f %7ld %12.2f %12.2f %10.2f\n", scenario.c_str(), name.c_str(),
+            entity_ticks / ticks, ticks, seconds * 1e9 / entity_ticks, entity_ticks / seconds / 1e6,
+            (double)allocations / ticks);
+    }
+};
+
+class scenario_c
+{
+public:
+    std::string name;
+    long ticks;
+    std::function<void(world_c&)> setup;
+};
+
+// SCENARIOS
+void add_bullets(world_c& game, size_t count, const std::string& program, uint64_t seed)
+{
+    lcg_c rnd(seed);
+    int p = pattern_library_c::find(game.patterns.bullets, program);
+    game.bullets.reserve(game.bullets.size() + count);
+    for (size_t i = 0; i < count; i++) {
+        bullet_c bullet;
+        bullet.position = vec2_t{real_t(rnd(0, 64)), real_t(rnd(0, 33))};
+        bullet.velocity = vec2_t{real_t(rnd(-5, 5)), real_t(rnd(-5, 5))};
+        bullet.acceleration = {0, 0};
+        bullet.program = p;
+        if (program == "wave") {
+            bullet.friction = 0.1;
+            bullet.type = game.sprites.id("bullet[1]");
+            bullet.damages_player = true;
+        }
+        else if (program == "shell") {
+            bullet.friction = 0.0;
+            bullet.type = game.sprites.id("bullet[0]");
+            bullet.blocked_by_obstacles = true;
+        }
+        else {
+            bullet.friction = 0.0;
+            bullet.type = game.sprites.id("bullet[1]");
+            bullet.damages_player = true;
+            bullet.blocked_by_obstacles = true;
+            bullet.destroyed_on_contact = true;
+        }
+        game.bullets.push_back(bullet);
+    }
+}
+
+void add_emitters(world_c& game, size_t count, uint64_t seed, const std::vector<std::string>& patterns = {})
+{
+    lcg_c rnd(seed);
+    auto prototypes = game.emitters;
+    for (size_t i = 0; i < count; i++) {
+        emitter_c e = prototypes[i % prototypes.size()];
+        if (patterns.size()) e.pattern = pattern_library_c::find(game.patterns.emitters, patterns[i % patterns.size()]);
+        e.position = vec2_t{real_t(rnd(0, 64)), real_t(rnd(0, 33))};
+        e.emit_delay = rnd(0.05, 0.5);
+        e.emit_to_emit = rnd(0, double(e.emit_delay));
+        game.emitters.push_back(e);
+    }
+}
+
+void add_players(world_c& game, size_t count, uint64_t seed)
+{
+    lcg_c rnd(seed);
+    for (size_t i = 0; i < count; i++) {
+        game.players.push_back(player_c(vec2_t{real_t(rnd(1, 63)), real_t(rnd(1, 32))}));
+    }
+}
+
+std::vector<scenario_c> scenarios()
+{
+    std::vector<scenario_c> ret;
+    ret.push_back({"level", 20000, [](world_c&) {}});
+    for (std::string program : {"wave", "shell", "push"}) {
+        for (size_t count : {10000, 100000, 1000000}) {
+            ret.push_back({"bullets_" + program + "_" + std::to_string(count / 1000) + "k",
+                (long)std::max<size_t>(5, 20000000 / count / 4), [=](world_c& game) {
+                    game.emitters.clear();
+                    add_bullets(game, count, program, 1000 + program.size());
+                }});
+        }
+    }
+    ret.push_back({"emitters_1k", 2000, [](world_c& game) { add_emitters(game, 1000, 7); }});
+    ret.push_back({"emitters_rings_spirals_100", 1000, [](world_c& game) { add_emitters(game, 100, 9, {"ring", "spiral"}); }});
+    ret.push_back({"players_100", 2000, [](world_c& game) { add_players(game, 100, 11); }});
+    ret.push_back({"players_1k_bullets_100k", 50, [](world_c& game) {
+                       add_players(game, 1000, 13);
+                       add_bullets(game, 100000, "wave", 17);
+                   }});
+    return ret;
+}
+
+void run(const scenario_c& scenario)
+{
+    world_c game;
+    initialize_world(game);
+    scenario.setup(game);
+    real_t dt_f = game.dt.count() / 1000.0;
+
+    phase_c events{"process_events"}, physics{"process_physics"}, bullet_update{"bullet update"}, player_update{"player update"};
+
+    // the whole tick, phase by phase - after one tick which is not measured, so
+    // allocs/tick is what a running game does, not the buffers growing at the start
+    process_events(game);
+    process_physics(game);
+    world_c start = game;
+    for (long t = 0; t < scenario.ticks; t++) {
+        events.measure(game.bullets.size() + game.players.size() + game.emitters.size(), [&] { process_events(game); });
+        physics.measure(game.bullets.size() + game.players.size(), [&] { process_physics(game); });
+    }
+
+    // entity updates alone, from the same starting state
+    game = start;
+    game.bullets.update(dt_f, game.patterns);
+    for (long t = 0; t < scenario.ticks; t++) {
+        bullet_update.measure(game.bullets.size(), [&] { game.bullets.update(dt_f, game.patterns); });
+        player_update.measure(game.players.size(), [&] {
+            for (auto& player : game.players) player.update(dt_f);
+        });
+    }
+
+    for (auto* phase : {&events, &physics, &bullet_update, &player_update}) phase->report(scenario.name);
+}
+
+int main(int argc, char** argv)
+{
+    std::string filter = (argc > 1) ? argv[1] : "";
+    std::printf("precision: %s\n", precision_names[precision]);
+    std::printf("integrator: %s\n", tp::integrate_implementation());
+    std::printf("%-26s %-14s %10s %7s %12s %12s %10s\n", "scenario", "phase", "entities", "ticks", "ns/entity", "Mentity/s", "allocs/tick");
+    for (auto& scenario : scenarios()) {
+        if (scenario.name.find(filter) == std::string::npos) continue;
+        run(scenario);
+        std::fflush(stdout);
+    }
+    return 0;
+}
@@ -1,42 +1,90 @@
 #ifndef __BMPFONT_TP_HPP___
 #define __BMPFONT_TP_HPP___
 
+#include "sprites.hpp"
 #include <SDL2/SDL.h>
-#include <SDL2/SDL_image.h>
-#include <iostream>
-#include <memory>
+#include <charconv>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
 namespace tp {
 
 /**
- * renderer, x, y, font texture, character to print
+ * bitmap font - a 16 x 16 glyph sheet in the sprite atlas, drawn multiplied by
+ * tint (so one white sheet serves fonts of every color).
+ * Glyph metrics are computed once, and every string drawn is laid out once
+ * and kept, so drawing the same text again only copies its vertices.
  * */
-int draw_char(std::shared_ptr<SDL_Renderer> r, int x, int y, std::shared_ptr<SDL_Texture> tex, char c, int w = 10, int h = 10)
+class bmpfont_c
 {
-    SDL_Rect dst_rect = {x, y, (int)w, (int)h};
-    SDL_Rect src_rect = {w * (int)(c & 0x0f), h * (int)((c & 0x0f0) >> 4), (int)w, (int)h};
-    double a = 0.0;
-    SDL_RenderCopyEx(r.get(), tex.get(), &src_rect, &dst_rect, a, NULL, SDL_RendererFlip::SDL_FLIP_NONE);
-    return x + w;
-}
+public:
+    SDL_Rect sheet = {0, 0, 0, 0};
+    int glyph_w = 0;
+    int glyph_h = 0;
+    float atlas_w = 1;
+    float atlas_h = 1;
+    SDL_Color tint = {255, 255, 255, 255};
 
-void draw_text(std::shared_ptr<SDL_Renderer> r, int x, int y, std::shared_ptr<SDL_Texture> tex, std::string txt)
-{
-    int w = 10, h = 10;
-    SDL_QueryTexture(tex.get(), NULL, NULL, &w, &h);
-    w = w / 16;
-    h = h / 16;
-    int x0 = x;
-
-    for (auto c : txt) {
-        if (c == '\n') {
-            x = x0;
-            y += h;
-        } else {
-            x = draw_char(r, x, y, tex, c, w, h);
+    bmpfont_c() = default;
+    /// glyph size 0 is a 16th of the sheet
+    bmpfont_c(const sprite_atlas_c& atlas, int sprite, SDL_Color tint_ = {255, 255, 255, 255}, int glyph_w_ = 0, int glyph_h_ = 0)
+        : sheet(atlas.at(sprite)), glyph_w(glyph_w_ ? glyph_w_ : sheet.w / 16), glyph_h(glyph_h_ ? glyph_h_ : sheet.h / 16),
+          atlas_w(atlas.width), atlas_h(atlas.height), tint(tint_)
+    {
+    }
+
+    /// glyph quads of txt, relative to its top left corner
+    const std::vector<SDL_Vertex>& layout(std::string_view txt)
+    {
+        key.assign(txt.begin(), txt.end());
+        auto found = runs.find(key);
+        if (found != runs.end()) return found->second;
+        if (runs.size() >= max_runs) runs.clear();
+
+        std::vector<SDL_Vertex> quads;
+        int x = 0, y = 0;
+        for (auto c : txt) {
+            if (c == '\n') {
+                x = 0;
+                y += glyph_h;
+                continue;
+            }
+            float u0 = (sheet.x + glyph_w * (c & 0x0f)) / atlas_w, u1 = u0 + glyph_w / atlas_w;
+            float v0 = (sheet.y + glyph_h * ((c & 0x0f0) >> 4)) / atlas_h, v1 = v0 + glyph_h / atlas_h;
+            float x0 = x, y0 = y, x1 = x + glyph_w, y1 = y + glyph_h;
+            quads.push_back({{x0, y0}, tint, {u0, v0}});
+            quads.push_back({{x1, y0}, tint, {u1, v0}});
+            quads.push_back({{x1, y1}, tint, {u1, v1}});
+            quads.push_back({{x0, y1}, tint, {u0, v1}});
+            x += glyph_w;
         }
+        return runs.emplace(key, std::move(quads)).first->second;
     }
+
+private:
+    static constexpr size_t max_runs = 1024;
+    std::unordered_map<std::string, std::vector<SDL_Vertex>> runs;
+    std::string key;
+};
+
+/**
+ * batch, x, y, font, text to print
+ * */
+inline void draw_text(sprite_batch_c& batch, int x, int y, bmpfont_c& font, std::string_view txt)
+{
+    batch.add_quads(font.layout(txt), x, y);
+}
+
+/**
+ * batch, x, y, font, number to print - without building a string
+ * */
+inline void draw_number(sprite_batch_c& batch, int x, int y, bmpfont_c& font, int n)
+{
+    char digits[16];
+    auto end = std::to_chars(digits, digits + sizeof(digits), n).ptr;
+    draw_text(batch, x, y, font, std::string_view(digits, end - digits));
 }
 } // namespace tp
 #endif
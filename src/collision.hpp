@@ -0,0 +1,97 @@
+#ifndef ___COLLISION_FOR_BULLETHELL_HPP__
+#define ___COLLISION_FOR_BULLETHELL_HPP__
+
+#include "world.hpp"
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+/**
+ * continuous collision of moving boxes with the obstacles (swept AABB).
+ *
+ * A box is tested along the whole move of a tick, not only where it ends, so
+ * fast bullets do not pass through thin obstacles and the tick can be longer.
+ * Boxes stop contact_skin away from the obstacle they hit; a box in the skin
+ * counts as touching, so one resting on the ground hits it at the start of
+ * every move down and slides along it without getting caught on tile seams.
+ * */
+
+/// gap kept between a moving box and the obstacle it touches
+constexpr real_t contact_skin = 0.001;
+
+class contact_c
+{
+public:
+    /// fraction of the move made before the contact
+    real_t time = 1;
+    /// of the obstacle surface which was hit, pointing out of it
+    vec2_t normal = {0, 0};
+};
+
+/**
+ * box with half size half, moving from from by delta, against an obstacle. true
+ * if it hits the obstacle before contact.time, then contact is set to the hit.
+ * A box which starts inside the obstacle is let out.
+ * */
+inline bool sweep_box(const vec2_t& from, const vec2_t& delta, const vec2_t& half, const obstacle_c& o, contact_c& contact)
+{
+    using std::abs;
+    real_t enter = -unbounded<real_t>(), exit = unbounded<real_t>();
+    int axis = -1;
+    for (int a = 0; a < 2; a++) {
+        // the obstacle grown by the box and the skin, the box is a point against it
+        real_t lo = o.position[a] - half[a] - contact_skin;
+        real_t hi = o.position[a] + o.size[a] + half[a] + contact_skin;
+        if (delta[a] == 0) {
+            // only a real overlap counts, a box in the skin slides past
+            if ((from[a] <= lo + contact_skin / 2) || (from[a] >= hi - contact_skin / 2)) return false;
+            continue;
+        }
+        real_t speed = abs(delta[a]);
+        real_t gap = (delta[a] > 0) ? lo - from[a] : from[a] - hi;
+        real_t through = gap + (hi - lo);
+        if (through <= 0) return false;
+        if (gap >= -contact_skin / 2) {
+            real_t t = std::max(gap, real_t(0)) / speed;
+            if (t > enter) {
+                enter = t;
+                axis = a;
+            }
+        }
+        exit = std::min(exit, through / speed);
+    }
+    if ((axis < 0) || (enter >= exit) || (enter >= contact.time)) return false;
+    contact.time = enter;
+    contact.normal = {0, 0};
+    contact.normal[axis] = (delta[axis] > 0) ? -1 : 1;
+    return true;
+}
+
+/**
+ * moves a box from from by delta through the obstacles found around the move,
+ * sliding along the ones it hits. on_contact(contact) is called for every hit, in
+ * order. Returns where the box ends.
+ * */
+template <typename F>
+inline vec2_t slide_box(const std::vector<obstacle_c>& obstacles, const std::vector<uint32_t>& found, vec2_t from, vec2_t delta,
+    const vec2_t& half, F on_contact)
+{
+    // every hit stops the move on one axis, so there are at most two
+    for (int hits = 0; hits < 2; hits++) {
+        contact_c contact;
+        bool hit = false;
+        for (auto k : found) {
+            hit = sweep_box(from, delta, half, obstacles[k], contact) || hit;
+        }
+        if (!hit) break;
+        for (int a = 0; a < 2; a++) {
+            from[a] += delta[a] * contact.time;
+            delta[a] = (contact.normal[a] != 0) ? real_t(0) : delta[a] * (1 - contact.time);
+        }
+        on_contact(contact);
+    }
+    return {from[0] + delta[0], from[1] + delta[1]};
+}
+
+#endif
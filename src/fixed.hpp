@@ -0,0 +1,162 @@
+#ifndef ___FIXED_FOR_BULLETHELL_HPP__
+#define ___FIXED_FOR_BULLETHELL_HPP__
+
+#include <cmath>
+#include <cstdint>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <type_traits>
+
+/**
+ * 32 bit fixed point number with 16 fraction bits (range +-32768, step 1/65536).
+ *
+ * Everything is integer arithmetic, so the results are the same with every
+ * compiler, optimization level and cpu - lockstep and replays stay bit exact.
+ * Numbers convert to it implicitly, rounded to the nearest step; results out of
+ * range saturate instead of wrapping. Back to floating point only explicitly.
+ * */
+class fixed_c
+{
+public:
+    static constexpr int fraction_bits = 16;
+    static constexpr int64_t one = int64_t(1) << fraction_bits;
+
+    int32_t raw = 0;
+
+    constexpr fixed_c() = default;
+    template <typename A, typename = std::enable_if_t<std::is_arithmetic<A>::value>>
+    constexpr fixed_c(A v) : raw(from(v)) {}
+
+    static constexpr fixed_c from_raw(int64_t r)
+    {
+        fixed_c f;
+        f.raw = saturate(r);
+        return f;
+    }
+
+    explicit constexpr operator double() const { return double(raw) / one; }
+    explicit constexpr operator float() const { return float(raw) / one; }
+
+    friend constexpr fixed_c operator-(fixed_c a) { return from_raw(-int64_t(a.raw)); }
+    friend constexpr fixed_c operator+(fixed_c a, fixed_c b) { return from_raw(int64_t(a.raw) + b.raw); }
+    friend constexpr fixed_c operator-(fixed_c a, fixed_c b) { return from_raw(int64_t(a.raw) - b.raw); }
+    // rounded to the nearest step, halves up
+    friend constexpr fixed_c operator*(fixed_c a, fixed_c b) { return from_raw((int64_t(a.raw) * b.raw + one / 2) >> fraction_bits); }
+    // rounded toward zero, division by zero saturates
+    friend constexpr fixed_c operator/(fixed_c a, fixed_c b)
+    {
+        if (b.raw == 0) return from_raw((a.raw < 0) ? INT64_MIN : (a.raw > 0) ? INT64_MAX : 0);
+        return from_raw(int64_t(a.raw) * one / b.raw);
+    }
+    friend constexpr fixed_c& operator+=(fixed_c& a, fixed_c b) { return a = a + b; }
+    friend constexpr fixed_c& operator-=(fixed_c& a, fixed_c b) { return a = a - b; }
+    friend constexpr fixed_c& operator*=(fixed_c& a, fixed_c b) { return a = a * b; }
+    friend constexpr fixed_c& operator/=(fixed_c& a, fixed_c b) { return a = a / b; }
+
+    friend constexpr bool operator==(fixed_c a, fixed_c b) { return a.raw == b.raw; }
+    friend constexpr bool operator!=(fixed_c a, fixed_c b) { return a.raw != b.raw; }
+    friend constexpr bool operator<(fixed_c a, fixed_c b) { return a.raw < b.raw; }
+    friend constexpr bool operator<=(fixed_c a, fixed_c b) { return a.raw <= b.raw; }
+    friend constexpr bool operator>(fixed_c a, fixed_c b) { return a.raw > b.raw; }
+    friend constexpr bool operator>=(fixed_c a, fixed_c b) { return a.raw >= b.raw; }
+
+private:
+    static constexpr int32_t saturate(int64_t r)
+    {
+        return (r > INT32_MAX) ? INT32_MAX : (r < INT32_MIN) ? INT32_MIN : int32_t(r);
+    }
+
+    template <typename A>
+    static constexpr int32_t from(A v)
+    {
+        if constexpr (std::is_floating_point<A>::value) {
+            double s = double(v) * one;
+            if (s != s) return 0;
+            if (s >= INT32_MAX) return INT32_MAX;
+            if (s <= INT32_MIN) return INT32_MIN;
+            return int32_t((s < 0) ? s - 0.5 : s + 0.5);
+        }
+        else {
+            if (v > A(INT32_MAX / one)) return INT32_MAX;
+            if (std::is_signed<A>::value && (int64_t(v) < INT32_MIN / one)) return INT32_MIN;
+            return int32_t(int64_t(v) * one);
+        }
+    }
+};
+
+namespace std {
+template <>
+class numeric_limits<fixed_c>
+{
+public:
+    static constexpr bool is_specialized = true;
+    static constexpr bool is_signed = true;
+    static constexpr bool is_exact = true;
+    static constexpr bool has_infinity = false;
+    static constexpr fixed_c min() { return fixed_c::from_raw(1); }
+    static constexpr fixed_c lowest() { return fixed_c::from_raw(INT32_MIN); }
+    static constexpr fixed_c max() { return fixed_c::from_raw(INT32_MAX); }
+    static constexpr fixed_c epsilon() { return fixed_c::from_raw(1); }
+};
+} // namespace std
+
+/**
+ * integer square root, floor(sqrt(v)) - the double estimate is off by at most
+ * one and corrected with integer math, so the result is exact everywhere
+ * */
+inline uint64_t isqrt(uint64_t v)
+{
+    uint64_t r = (uint64_t)std::sqrt((double)v);
+    while (r > 0 && ((r > UINT32_MAX) || (r * r > v))) r--;
+    while ((r < UINT32_MAX) && ((r + 1) * (r + 1) <= v)) r++;
+    return r;
+}
+
+constexpr fixed_c abs(fixed_c a) { return (a.raw < 0) ? -a : a; }
+constexpr fixed_c floor(fixed_c a) { return fixed_c::from_raw(a.raw & ~int32_t(fixed_c::one - 1)); }
+/// of negative numbers is 0
+inline fixed_c sqrt(fixed_c a) { return fixed_c::from_raw((a.raw <= 0) ? 0 : isqrt(uint64_t(a.raw) << fixed_c::fraction_bits)); }
+/// sqrt(x * x + y * y) without overflowing in between
+inline fixed_c norm(fixed_c x, fixed_c y)
+{
+    return fixed_c::from_raw(isqrt(uint64_t(int64_t(x.raw) * x.raw) + uint64_t(int64_t(y.raw) * y.raw)));
+}
+
+/**
+ * sine of x radians with 30 fraction bits - reduced to [-pi/2, pi/2], then the
+ * Taylor series to x^11, which is exact to the step of fixed_c
+ * */
+constexpr fixed_c fixed_sin(int64_t x)
+{
+    constexpr int64_t pi = 3373259426; // with 30 fraction bits
+    x %= 2 * pi;
+    if (x > pi) x -= 2 * pi;
+    if (x < -pi) x += 2 * pi;
+    if (x > pi / 2) x = pi - x;
+    if (x < -pi / 2) x = -pi - x;
+    int64_t x2 = (x * x) >> 30;
+    int64_t term = x, sum = x;
+    for (int64_t k = 2; k <= 10; k += 2) {
+        term = -((term * x2) >> 30) / (k * (k + 1));
+        sum += term;
+    }
+    return fixed_c::from_raw((sum + (1 << 13)) >> 14);
+}
+
+constexpr fixed_c sin(fixed_c a) { return fixed_sin(int64_t(a.raw) * (1 << 14)); }
+constexpr fixed_c cos(fixed_c a) { return fixed_sin(int64_t(a.raw) * (1 << 14) + 3373259426 / 2); }
+
+inline std::ostream& operator<<(std::ostream& o, fixed_c a)
+{
+    return o << double(a);
+}
+
+inline std::istream& operator>>(std::istream& i, fixed_c& a)
+{
+    double v;
+    if (i >> v) a = v;
+    return i;
+}
+
+#endif
@@ -0,0 +1,67 @@
+#include "profiler.hpp"
+#include "simulation.hpp"
+#include "snapshot.hpp"
+#include <chrono>
+#include <iostream>
+#include <string>
+
+/**
+ * steps the simulation as fast as possible, without a window or input
+ *
+ * usage: gotyheadless [ticks] [--load file] [--save file] [--trace file] [--dt ms]
+ *   --load starts from a snapshot instead of the level, --save writes one at the end,
+ *   --trace writes the profiled phases as Chrome trace JSON, --dt sets the tick length
+ * */
+int main(int argc, char** argv)
+{
+    using namespace std::chrono;
+    long ticks = 100000;
+    long dt_ms = 0;
+    std::string load_file, save_file, trace_file;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if ((arg == "--load") && (i + 1 < argc)) load_file = argv[++i];
+        else if ((arg == "--save") && (i + 1 < argc)) save_file = argv[++i];
+        else if ((arg == "--trace") && (i + 1 < argc)) trace_file = argv[++i];
+        else if ((arg == "--dt") && (i + 1 < argc)) dt_ms = std::stol(argv[++i]);
+        else ticks = std::stol(arg);
+    }
+
+    world_c game;
+    initialize_world(game);
+    if (load_file.size()) {
+        steady_clock::time_point start = steady_clock::now();
+        if (!load_snapshot(game, load_file)) {
+            std::cerr << load_file << ": not a snapshot" << std::endl;
+            return 1;
+        }
+        std::cout << "loaded " << game.bullets.size() << " bullets in "
+                  << duration<double>(steady_clock::now() - start).count() * 1000.0 << " ms" << std::endl;
+    }
+    // collisions are swept, so longer ticks do not let bullets through obstacles
+    if (dt_ms > 0) game.dt = milliseconds(dt_ms);
+
+    if (trace_file.size()) profiler.start_trace();
+    steady_clock::time_point start = steady_clock::now();
+    for (long t = 0; t < ticks; t++) {
+        process_events(game);
+        process_physics(game);
+    }
+    double seconds = duration<double>(steady_clock::now() - start).count();
+    if (trace_file.size() && !profiler.write_trace(trace_file)) {
+        std::cerr << trace_file << ": can not write the trace" << std::endl;
+    }
+
+    std::cout << ticks << " ticks (" << ticks * game.dt.count() / 1000.0 << " s of game time) in "
+              << seconds << " s, " << ticks / seconds << " ticks/s" << std::endl;
+    std::cout << "bullets: " << game.bullets.size() << std::endl;
+    for (unsigned i = 0; i < game.players.size(); i++) {
+        std::cout << "player " << i << ": health " << game.players[i].health << " position ["
+                  << game.players[i].position[0] << "," << game.players[i].position[1] << "]" << std::endl;
+    }
+    if (save_file.size() && !save_snapshot(game, save_file)) {
+        std::cerr << save_file << ": can not save" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,103 @@
+#ifndef ___INPUT_FOR_BULLETHELL_HPP__
+#define ___INPUT_FOR_BULLETHELL_HPP__
+
+#include "world.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * keyboard bindings - which scancode sets which intent of which player.
+ *
+ * Bindings are edited per player and intent, then compiled into a flat table of
+ * (scancode, player, intent bits) sorted by scancode, so sampling the keyboard is
+ * one load and one or per binding.
+ * */
+class key_bindings_c
+{
+public:
+    class binding_c
+    {
+    public:
+        uint16_t scancode;
+        uint16_t player;
+        uint32_t intents;
+    };
+
+    /// scancode of each intent of each player, 0 is unbound
+    std::vector<std::array<uint16_t, INTENT_COUNT>> keys;
+    std::vector<binding_c> compiled;
+
+    /// binds the key (replacing the previous one) and recompiles
+    void bind(unsigned player, intent_e intent, uint16_t scancode)
+    {
+        if (player >= keys.size()) keys.resize(player + 1, std::array<uint16_t, INTENT_COUNT>{});
+        keys[player][bit_index(intent)] = scancode;
+        compile();
+    }
+
+    /// by name, for configuration - false if there is no such intent
+    bool bind(unsigned player, const std::string& intent, uint16_t scancode)
+    {
+        for (int i = 0; i < INTENT_COUNT; i++) {
+            if (intent == intent_names[i]) {
+                bind(player, (intent_e)(1u << i), scancode);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void unbind(unsigned player, intent_e intent)
+    {
+        if (player < keys.size()) keys[player][bit_index(intent)] = 0;
+        compile();
+    }
+
+    void compile()
+    {
+        compiled.clear();
+        for (unsigned p = 0; p < keys.size(); p++) {
+            for (int i = 0; i < INTENT_COUNT; i++) {
+                if (keys[p][i]) compiled.push_back({keys[p][i], (uint16_t)p, 1u << i});
+            }
+        }
+        std::sort(compiled.begin(), compiled.end(), [](auto& a, auto& b) {
+            return (a.scancode != b.scancode) ? (a.scancode < b.scancode) : (a.player < b.player);
+        });
+        // one key driving several intents of one player is a single entry
+        unsigned n = 0;
+        for (unsigned i = 0; i < compiled.size(); i++) {
+            if (n > 0 && compiled[n - 1].scancode == compiled[i].scancode && compiled[n - 1].player == compiled[i].player) {
+                compiled[n - 1].intents |= compiled[i].intents;
+            }
+            else {
+                compiled[n++] = compiled[i];
+            }
+        }
+        compiled.resize(n);
+    }
+
+    size_t players() const { return keys.size(); }
+
+    /// keyboard state indexed by scancode, intents has one entry per player
+    void sample(const uint8_t* keyboard, uint32_t* intents) const
+    {
+        std::fill(intents, intents + keys.size(), 0);
+        for (auto& b : compiled) {
+            intents[b.player] |= keyboard[b.scancode] ? b.intents : 0;
+        }
+    }
+
+private:
+    static int bit_index(intent_e intent)
+    {
+        int i = 0;
+        while (!((uint32_t)intent & (1u << i))) i++;
+        return i;
+    }
+};
+
+#endif
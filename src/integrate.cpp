@@ -0,0 +1,131 @@
+#include "integrate.hpp"
+#include <cstdlib>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define INTEGRATE_X86
+#endif
+
+namespace tp {
+
+static_assert(sizeof(vec2_c<double>) == 2 * sizeof(double), "vectors are read as pairs of doubles");
+
+/*
+ * All versions evaluate the expressions of physical_c::update in the same order:
+ *   a' = a - v * |v| * f   (a' = a without drag)
+ *   v' = v + a' * dt
+ *   p' = p + v' * dt + a' * dt * dt * 0.5
+ * and the compiler is not allowed to contract them into fma, so they round identically.
+ * The scalar version is the template of integrate.hpp.
+ */
+
+#ifdef INTEGRATE_X86
+
+// one entity per register - {x, y}
+template <bool DRAG>
+static void integrate_sse2(vec2_c<double>* position, vec2_c<double>* velocity, vec2_c<double>* acceleration,
+    const double* friction, size_t n, double dt_f)
+{
+    double* p = position[0].data();
+    double* v = velocity[0].data();
+    double* a = acceleration[0].data();
+    const __m128d dt = _mm_set1_pd(dt_f);
+    const __m128d half = _mm_set1_pd(0.5);
+    for (size_t i = 0; i < n; i++) {
+        __m128d vi = _mm_loadu_pd(v + 2 * i);
+        __m128d na = _mm_loadu_pd(a + 2 * i);
+        if constexpr (DRAG) {
+            __m128d sq = _mm_mul_pd(vi, vi);
+            __m128d len = _mm_sqrt_pd(_mm_add_pd(sq, _mm_shuffle_pd(sq, sq, 1)));
+            na = _mm_sub_pd(na, _mm_mul_pd(_mm_mul_pd(vi, len), _mm_set1_pd(friction[i])));
+        }
+        __m128d nv = _mm_add_pd(vi, _mm_mul_pd(na, dt));
+        __m128d np = _mm_add_pd(_mm_add_pd(_mm_loadu_pd(p + 2 * i), _mm_mul_pd(nv, dt)),
+            _mm_mul_pd(_mm_mul_pd(_mm_mul_pd(na, dt), dt), half));
+        _mm_storeu_pd(p + 2 * i, np);
+        _mm_storeu_pd(v + 2 * i, nv);
+        _mm_storeu_pd(a + 2 * i, na);
+    }
+}
+
+// two entities per register - {x0, y0, x1, y1}
+template <bool DRAG>
+__attribute__((target("avx2"))) static void integrate_avx2(vec2_c<double>* position, vec2_c<double>* velocity,
+    vec2_c<double>* acceleration, const double* friction, size_t n, double dt_f)
+{
+    double* p = position[0].data();
+    double* v = velocity[0].data();
+    double* a = acceleration[0].data();
+    const __m256d dt = _mm256_set1_pd(dt_f);
+    const __m256d half = _mm256_set1_pd(0.5);
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m256d vi = _mm256_loadu_pd(v + 2 * i);
+        __m256d na = _mm256_loadu_pd(a + 2 * i);
+        if constexpr (DRAG) {
+            __m256d sq = _mm256_mul_pd(vi, vi);
+            __m256d len = _mm256_sqrt_pd(_mm256_add_pd(sq, _mm256_permute_pd(sq, 0x5)));
+            __m256d f = _mm256_set_pd(friction[i + 1], friction[i + 1], friction[i], friction[i]);
+            na = _mm256_sub_pd(na, _mm256_mul_pd(_mm256_mul_pd(vi, len), f));
+        }
+        __m256d nv = _mm256_add_pd(vi, _mm256_mul_pd(na, dt));
+        __m256d np = _mm256_add_pd(_mm256_add_pd(_mm256_loadu_pd(p + 2 * i), _mm256_mul_pd(nv, dt)),
+            _mm256_mul_pd(_mm256_mul_pd(_mm256_mul_pd(na, dt), dt), half));
+        _mm256_storeu_pd(p + 2 * i, np);
+        _mm256_storeu_pd(v + 2 * i, nv);
+        _mm256_storeu_pd(a + 2 * i, na);
+    }
+    if (i < n) integrate_sse2<DRAG>(position + i, velocity + i, acceleration + i, DRAG ? friction + i : nullptr, n - i, dt_f);
+}
+
+#endif
+
+using integrate_f = void (*)(vec2_c<double>*, vec2_c<double>*, vec2_c<double>*, const double*, size_t, double);
+
+class integrator_c
+{
+public:
+    integrate_f drag;
+    integrate_f no_drag;
+    const char* name;
+};
+
+// GOTY_INTEGRATE=scalar|sse2 in the environment forces a slower implementation
+static integrator_c select_integrate()
+{
+    const char* env = std::getenv("GOTY_INTEGRATE");
+    std::string forced = env ? env : "";
+    if (forced == "scalar") return {integrate<double>, integrate<double>, "scalar"};
+#ifdef INTEGRATE_X86
+    if (forced == "sse2") return {integrate_sse2<true>, integrate_sse2<false>, "sse2"};
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return {integrate_avx2<true>, integrate_avx2<false>, "avx2"};
+    return {integrate_sse2<true>, integrate_sse2<false>, "sse2"};
+#else
+    return {integrate<double>, integrate<double>, "scalar"};
+#endif
+}
+
+// selected on first use, not while the program starts
+static const integrator_c& selected_integrate()
+{
+    static const integrator_c selected = select_integrate();
+    return selected;
+}
+
+void integrate(vec2_c<double>* position, vec2_c<double>* velocity, vec2_c<double>* acceleration,
+    const double* friction, size_t n, double dt_f)
+{
+    if (!n) return;
+    auto& s = selected_integrate();
+    if (friction) s.drag(position, velocity, acceleration, friction, n, dt_f);
+    else s.no_drag(position, velocity, acceleration, nullptr, n, dt_f);
+}
+
+const char* integrate_implementation()
+{
+    return selected_integrate().name;
+}
+
+} // namespace tp
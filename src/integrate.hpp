@@ -0,0 +1,37 @@
+#ifndef ___INTEGRATE_FOR_BULLETHELL_HPP__
+#define ___INTEGRATE_FOR_BULLETHELL_HPP__
+
+#include "vectors.hpp"
+#include <cstddef>
+
+namespace tp {
+
+/**
+ * basic physics (the same as physical_c::update) for n entities stored in contiguous arrays,
+ * without the drag term when friction is nullptr.
+ * Uses AVX2 or SSE2 when the cpu has it, results are identical to the scalar version.
+ * */
+void integrate(vec2_c<double>* position, vec2_c<double>* velocity, vec2_c<double>* acceleration,
+    const double* friction, size_t n, double dt_f);
+
+/// the same for the other scalar types, one entity after another
+template <typename T>
+void integrate(vec2_c<T>* position, vec2_c<T>* velocity, vec2_c<T>* acceleration, const T* friction, size_t n, T dt_f)
+{
+    for (size_t i = 0; i < n; i++) {
+        auto new_acceleration = acceleration[i];
+        if (friction) new_acceleration = acceleration[i] - velocity[i] * length(velocity[i]) * friction[i];
+        auto new_velocity = velocity[i] + new_acceleration * dt_f;
+        auto new_position = position[i] + new_velocity * dt_f + new_acceleration * dt_f * dt_f * 0.5;
+        position[i] = new_position;
+        velocity[i] = new_velocity;
+        acceleration[i] = new_acceleration;
+    }
+}
+
+/// name of the implementation selected for this cpu - "avx2", "sse2" or "scalar"
+const char* integrate_implementation();
+
+} // namespace tp
+
+#endif
@@ -1,3 +1,4 @@
+#include "asset_pack.hpp"
 #include "bmpfont.hpp"
 #include "vectors.hpp"
 #include <SDL2/SDL.h>
@@ -5,6 +6,7 @@
 #include <array>
 #include <chrono>
 #include <cstdint>
+#include <cstdio>
 #include <functional>
 #include <iomanip>
 #include <iostream>
@@ -19,6 +21,7 @@
 #include <algorithm>
 
 #include "main.hpp"
+#include "simulation.hpp"
 
 std::ostream& operator<<(std::ostream& o, const std::array<double, 2>& a)
 {
@@ -26,110 +29,81 @@ std::ostream& operator<<(std::ostream& o, const std::array<double, 2>& a)
     return o;
 }
 
-void draw_o(std::shared_ptr<SDL_Renderer> r, std::array<double, 2> p, std::shared_ptr<SDL_Texture> tex, double w, double h, double a, bool flip=false)
+void draw_o(tp::sprite_batch_c& batch, std::array<double, 2> p, const SDL_Rect& sprite, double w, double h, double a, bool flip=false)
 {
     SDL_Rect dst_rect = {(int)(p[0] - w / 2), (int)(p[1] - h / 2), (int)w, (int)h};
-    SDL_RendererFlip sdl_flip = (flip) ? SDL_RendererFlip::SDL_FLIP_HORIZONTAL : SDL_RendererFlip::SDL_FLIP_NONE;
-    SDL_RenderCopyEx(r.get(), tex.get(), NULL, &dst_rect, a, NULL, sdl_flip);
+    batch.add(sprite, dst_rect, a, flip);
 }
 
-void draw_obstacle(std::shared_ptr<SDL_Renderer> r, std::array<double, 2> p, std::shared_ptr<SDL_Texture> tex, double w, double h, double a)
+void draw_obstacle(tp::sprite_batch_c& batch, std::array<double, 2> p, const SDL_Rect& sprite, double w, double h, double a)
 {
     SDL_Rect dst_rect = {(int)p[0], (int)p[1], (int)w, (int)h};
-    SDL_RenderCopyEx(r.get(), tex.get(), NULL, &dst_rect, a, NULL, SDL_RendererFlip::SDL_FLIP_NONE);
+    batch.add(sprite, dst_rect, a);
 }
 
-void initialize_players(game_c &game)
+void initialize_keyboard(game_c &game)
 {
-    game.players.push_back(player_c({4, 30}));
-    //game.players.push_back(player_c({1.5, 10}));
-
     // player keyboard mapping
     // player 0
-    game.keyboard_map.push_back({{"right", SDL_SCANCODE_RIGHT},
-        {"left", SDL_SCANCODE_LEFT},
-        {"gun_up", SDL_SCANCODE_UP},
-        {"gun_down", SDL_SCANCODE_DOWN},
-        {"up", SDL_SCANCODE_SPACE},
-        {"shoot", SDL_SCANCODE_LSHIFT},
-        {"down", SDL_SCANCODE_LCTRL}
-    });
+    auto& keys = game.key_bindings;
+    keys.bind(0, INTENT_RIGHT, SDL_SCANCODE_RIGHT);
+    keys.bind(0, INTENT_LEFT, SDL_SCANCODE_LEFT);
+    keys.bind(0, INTENT_GUN_UP, SDL_SCANCODE_UP);
+    keys.bind(0, INTENT_GUN_DOWN, SDL_SCANCODE_DOWN);
+    keys.bind(0, INTENT_UP, SDL_SCANCODE_SPACE);
+    keys.bind(0, INTENT_SHOOT, SDL_SCANCODE_LSHIFT);
+    keys.bind(0, INTENT_DOWN, SDL_SCANCODE_LCTRL);
+    keys.bind(0, INTENT_WARP_TOP, SDL_SCANCODE_Q);
+    keys.bind(0, INTENT_WARP_SPAWN, SDL_SCANCODE_R);
     // player 1
-//     game.keyboard_map.push_back({{"right", SDL_SCANCODE_D},
-//         {"left", SDL_SCANCODE_A},
-//         {"up", SDL_SCANCODE_W},
-//         {"down", SDL_SCANCODE_S}});
+//     keys.bind(1, INTENT_RIGHT, SDL_SCANCODE_D);
+//     keys.bind(1, INTENT_LEFT, SDL_SCANCODE_A);
+//     keys.bind(1, INTENT_UP, SDL_SCANCODE_W);
+//     keys.bind(1, INTENT_DOWN, SDL_SCANCODE_S);
 }
 
-void gen_obstacle_rect(game_c &game, double x, double y, int width, int height, std::string texture)
+/**
+ * sprites and fonts - uploaded from the baked pack, or decoded from the images
+ * of the asset list when there is no valid pack
+ * */
+void initialize_media(game_c& game)
 {
-    for (int i=0; i<width; i++) {
-        for (int j=0; j<height; j++) {
-            obstacle_c o;
-            o.position = {x+i, y+j};
-            o.size = {1,1};
-            o.texture = texture;
-            game.obstacles.push_back(o);
+    // sprite handles are the ids of sprite names in the world, so entities refer to them directly
+    std::map<std::string, tp::bmpfont_c> fonts;
+    asset_pack_c pack;
+    if (pack.open("data/assets.pack")) {
+        game.atlas.width = pack.width;
+        game.atlas.height = pack.height;
+        std::vector<uint16_t> handles;
+        for (size_t i = 0; i < pack.sprite_names.size(); i++) {
+            handles.push_back(game.sprites.id(pack.sprite_names[i]));
+            game.atlas.place(handles.back(), pack.sprites[i]);
+        }
+        game.atlas.upload(game.renderer_p.get(), pack.pixels, pack.width * 4);
+        for (size_t i = 0; i < pack.font_names.size(); i++) {
+            auto& f = pack.fonts[i];
+            SDL_Color tint = {f.tint[0], f.tint[1], f.tint[2], f.tint[3]};
+            fonts[pack.font_names[i]] = tp::bmpfont_c(game.atlas, handles[f.sheet], tint, f.glyph_w, f.glyph_h);
+        }
+    } else {
+        std::vector<asset_c> assets;
+        if (!load_asset_list("data/assets.txt", assets)) throw std::runtime_error("data/assets.txt: can not read the asset list");
+        std::vector<std::pair<int, std::string>> sprite_files;
+        for (auto& a : assets) sprite_files.push_back({game.sprites.id(a.name), a.file});
+        game.atlas.build(game.renderer_p.get(), sprite_files);
+        for (auto& a : assets) {
+            if (a.kind == ASSET_FONT) fonts[a.name] = tp::bmpfont_c(game.atlas, game.sprites.id(a.name));
         }
     }
+    game.sprite_gun = game.sprites.id("gun");
+    game.sprite_guy = game.sprites.id("guy");
+    game.font_10 = fonts["font_10"];
+    game.font_10_red = fonts["font_10_red"];
+    game.font_10_blue = fonts["font_10_blue"];
 }
 
-void initialize_obstacles(game_c &game)
+void initialize_all(game_c &game)
 {
-    // outer walls
-    gen_obstacle_rect(game, -1, -1, 64, 1, "block1");
-    gen_obstacle_rect(game, -1, 0, 1, 36, "block1");
-    //gen_obstacle_rect(game, 64, 0, 1, 36, "block1");
-
-    //ground
-    gen_obstacle_rect(game, 0, 33, 64, 3, "block1");
-
-
-    // floor 1
-    gen_obstacle_rect(game, 0, 23, 50, 2, "block1");
-    gen_obstacle_rect(game, 55, 23, 9, 2, "block1");
-
-    gen_obstacle_rect(game, 52, 28, 3, 1, "block1");
-
-    // floor 2
-    gen_obstacle_rect(game, 0, 13, 9, 2, "block1");
-    gen_obstacle_rect(game, 14, 13, 50, 2, "block1");
-
-    gen_obstacle_rect(game, 9, 18, 3, 1, "block1");
-
-
-    gen_obstacle_rect(game, 10, 29, 5, 1, "block1");
-    gen_obstacle_rect(game, 15, 30, 5, 1, "block1");
-
-    gen_obstacle_rect(game, 20, 29, 1, 4, "block1");
-}
-
-void initialize_emitters(game_c &game)
-{
-
-    emitter_c emitter1;
-    emitter1.position = {-5, 20};
-    emitter1.friction = 0;
-    emitter1.acceleration = {0, 0};
-    emitter1.velocity = {0, 0};
-    emitter1.emit_delay = 1;
-    emitter1.emit_to_emit = 0;
-    game.emitters.push_back(emitter1);
-
-    emitter_c emitter2;
-    emitter2.position = {65, 31};
-    emitter2.friction = 0;
-    emitter2.acceleration = {0, 0};
-    emitter2.velocity = {0, 0};
-    emitter2.emit_delay = 1;
-    emitter2.emit_to_emit = 0;
-    game.emitters.push_back(emitter2);
-
-}
-
-game_c initialize_all()
-{
-    game_c game;
     /// SDL
     SDL_Init(SDL_INIT_EVERYTHING);
     IMG_Init(IMG_INIT_PNG);
@@ -141,7 +115,7 @@ game_c initialize_all()
         [](auto* window) { SDL_DestroyWindow(window); });
 
     game.renderer_p = std::shared_ptr<SDL_Renderer>(
-        SDL_CreateRenderer(game.window_p.get(), -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC),
+        SDL_CreateRenderer(game.window_p.get(), -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC | SDL_RENDERER_TARGETTEXTURE),
         [](auto* renderer) {
             SDL_DestroyRenderer(renderer);
         });
@@ -150,361 +124,265 @@ game_c initialize_all()
     SDL_RenderSetLogicalSize(game.renderer_p.get(), 640, 360);
 
     /// MEDIA
-    for (int i = 0; i < 3; i++) {
-        game.textures["player[" + std::to_string(i) + "]"] = std::shared_ptr<SDL_Texture>(IMG_LoadTexture(game.renderer_p.get(), (std::string("data/player") + std::to_string(i) + ".png").c_str()),
-            [](auto* tex) { SDL_DestroyTexture(tex); });
-    }
-    for (int i = 0; i < 3; i++) {
-        game.textures["bullet[" + std::to_string(i) + "]"] = std::shared_ptr<SDL_Texture>(IMG_LoadTexture(game.renderer_p.get(), (std::string("data/bullet") + std::to_string(i) + ".png").c_str()),
-            [](auto* tex) { SDL_DestroyTexture(tex); });
-    }
-    for (int i = 0; i < 1; i++) {
-        game.textures["emitter[" + std::to_string(i) + "]"] = std::shared_ptr<SDL_Texture>(IMG_LoadTexture(game.renderer_p.get(), (std::string("data/emitter") + std::to_string(i) + ".png").c_str()),
-            [](auto* tex) { SDL_DestroyTexture(tex); });
-    }
-    game.textures["font_10"] = std::shared_ptr<SDL_Texture>(IMG_LoadTexture(game.renderer_p.get(), "data/oqls65n.png"),
-        [](auto* tex) { SDL_DestroyTexture(tex); });
-
-    game.textures["font_10_red"] = std::shared_ptr<SDL_Texture>(IMG_LoadTexture(game.renderer_p.get(), "data/oqls65n_red.png"),
-        [](auto* tex) { SDL_DestroyTexture(tex); });
+    initialize_media(game);
 
-    game.textures["font_10_blue"] = std::shared_ptr<SDL_Texture>(IMG_LoadTexture(game.renderer_p.get(), "data/oqls65n_blue.png"),
-        [](auto* tex) { SDL_DestroyTexture(tex); });
+    /// SIMULATION
+    initialize_world(game);
 
-    game.textures["block1"] = std::shared_ptr<SDL_Texture>(IMG_LoadTexture(game.renderer_p.get(), "data/block1.png"),
-        [](auto* tex) { SDL_DestroyTexture(tex); });
-
-    game.textures["gun"] = std::shared_ptr<SDL_Texture>(IMG_LoadTexture(game.renderer_p.get(), "data/gun.png"),
-        [](auto* tex) { SDL_DestroyTexture(tex); });
-
-    game.textures["guy"] = std::shared_ptr<SDL_Texture>(IMG_LoadTexture(game.renderer_p.get(), "data/guy.png"),
-        [](auto* tex) { SDL_DestroyTexture(tex); });
-
-
-    /// PLAYERS
-    initialize_players(game);
-
-    /// OBSTACLES
-    initialize_obstacles(game);
-
-    /// EMITTERS
-    initialize_emitters(game);
-
-    /// physics details
-    game.dt = std::chrono::milliseconds(15);
-
-    return game;
+    /// KEYBOARD
+    initialize_keyboard(game);
 }
 
 
 int process_input(game_c& game)
 {
+    profile_scope_c profile(PROFILE_INPUT);
     SDL_Event event;
     while (SDL_PollEvent(&event)) {
         if (event.type == SDL_QUIT)
             return false;
+        if ((event.type == SDL_KEYDOWN) && !event.key.repeat && (event.key.keysym.scancode == SDL_SCANCODE_F1))
+            game.show_profile = !game.show_profile;
+        // render targets lost their content
+        if (event.type == SDL_RENDER_TARGETS_RESET)
+            game.obstacle_layer.invalidate();
+        // every texture is lost - the atlas (and the fonts on it) is uploaded again like at startup
+        if (event.type == SDL_RENDER_DEVICE_RESET) {
+            initialize_media(game);
+            game.obstacle_layer = {};
+        }
     }
     auto kbdstate = SDL_GetKeyboardState(NULL);
     if (kbdstate[SDL_SCANCODE_ESCAPE]) return false;
-    if (kbdstate[SDL_SCANCODE_Q]) {
-        game.players[0].position = {4, 10};
-    }
-    if (kbdstate[SDL_SCANCODE_R]) {
-        game.players[0].position = {4, 30};
-    }
-    for (unsigned i = 0; i < game.players.size(); i++) {
-        for (auto [k, v] : game.keyboard_map.at(i)) {
-            if (kbdstate[v]) game.players.at(i).intentions[k] = 1;
-        }
-    }
+
+    // the simulation thread picks it up at its next tick
+    std::lock_guard<std::mutex> lock(game.input_mutex);
+    game.input.intentions.resize(game.key_bindings.players());
+    game.key_bindings.sample(kbdstate, game.input.intentions.data());
+    game.input.rewind = kbdstate[SDL_SCANCODE_BACKSPACE];
     return true;
 }
 
-void process_events(game_c& game)
+/**
+ * simulation thread - fixed time step, independent of the frame rate.
+ * After every tick the state is published for the renderer.
+ * */
+void simulate(game_c& game)
 {
-    using namespace tp::operators;
-    double dt_f = game.dt.count() / 1000.0;
-    /// apply safe place and hit points
-//     for (unsigned i = 0; i < game.players.size(); i++) {
-//         auto& p = game.players[i];
-//         if ((p.is_safe_place())) {
-//             p.health += dt_f * 10.0;
-//             if (p.health > 100.0) p.health = 100;
-//         } else {
-//             p.points += dt_f * 10.0;
-//         }
-//     }
-
-    // EMITTERS
-    for (unsigned i = 0; i < game.emitters.size(); i++) {
-        auto& e = game.emitters[i];
-        e.emit_to_emit -= dt_f;
-
-        if (i == 0) {
-            if (e.emit_to_emit <= 0.0) {
-                e.emit_to_emit = e.emit_delay;
-                //game.bullets.push_back(bullet_c({e.position, {0, 0}, {0.0, 0.0},0.1,"bullet[0]","a"}));
-                bullet_c bullet;
-                bullet.position = e.position;
-                bullet.velocity = {0, 0};
-                bullet.acceleration = {0.0, 0.0};
-                bullet.friction = 0.1;
-                bullet.type = "bullet[1]";
-                bullet.behavior = "a";
-                bullet.damages_player = true;
-                game.bullets.push_back(bullet);
+    using namespace std::chrono;
+    profiler.name_thread("simulation");
+    auto obstacles = std::make_shared<const std::vector<obstacle_c>>(game.obstacles);
+    uint64_t obstacles_version = game.obstacles_version;
+    input_c input;
+
+    steady_clock::time_point start = steady_clock::now();
+    uint64_t tick = 0;
+    // ticks of the game, these go back when rewinding
+    uint64_t game_tick = 0;
+    game.rollback.push(game, game_tick);
+    game.views.begin_write().capture(game, tick, start, obstacles);
+    game.views.publish();
+
+    while (game.running) {
+        // catch up with the clock, but drop the backlog after a long stall instead of spiralling
+        for (int steps = 0; start + (tick + 1) * game.dt <= steady_clock::now(); steps++) {
+            if (steps == 8) {
+                start = steady_clock::now() - tick * game.dt;
+                break;
             }
-        }
-        else if (i == 1) {
-            if (e.emit_to_emit <= 0.0) {
-                e.emit_to_emit = e.emit_delay;
-                //game.bullets.push_back(bullet_c({e.position, {0, 0}, {0.0, 0.0},0.1,"bullet[0]","a"}));
-                bullet_c bullet;
-                bullet.position = e.position;
-                bullet.velocity = {0, 0};
-                bullet.acceleration = {0.0, 0.0};
-                bullet.friction = 0.0;
-                bullet.type = "bullet[1]";
-                bullet.behavior = "c";
-                bullet.damages_player = true;
-                bullet.blocked_by_obstacles = true;
-                bullet.destroyed_on_contact = true;
-                game.bullets.push_back(bullet);
+            {
+                std::lock_guard<std::mutex> lock(game.input_mutex);
+                input = game.input;
+            }
+            tick++;
+            // rewinding is for debugging, a recording could not replay it
+            if (input.rewind && !game.recorder.is_open() && (game_tick > game.rollback.oldest())) {
+                game.rollback.restore(game, --game_tick);
+            }
+            else {
+                if (game.recorder.is_open()) game.recorder.record(input.intentions);
+                apply_intents(game, input.intentions);
+                process_events(game);
+                process_physics(game);
+                game.rollback.push(game, ++game_tick);
+                // about once a second, so a replay can tell where it went different
+                if (game.recorder.is_open() && (game_tick % 64 == 0)) game.recorder.hash(state_hash(game));
             }
-        }
-
-    }
-
-    // PLAYER SHOOTING
-    if (game.players[0].intentions.count("shoot")) {
-        double angle = game.players[0].gun_angle + 90;
-        if (game.players[0].last_move_left) {
-            angle = -angle;
-        }
-        double rad = angle * M_PI / 180;
-        std::array<double, 2> acceleration = { sin(rad) * 30, cos(rad) * 30 };
-
-        bullet_c bullet;
-        rad = -angle * M_PI / 180;
-        bullet.position = {game.players[0].position[0] - sin(rad) * 2.0, game.players[0].position[1] - 0.2 + cos(rad) * 2.0};
-        bullet.velocity = acceleration;
-        bullet.velocity[0] += game.players[0].velocity[0];
-        bullet.velocity[1] += game.players[0].velocity[1];
-        bullet.acceleration = {0, 0};
-        bullet.friction = 0.0;
-        bullet.type = "bullet[0]";
-        bullet.behavior = "b";
-        bullet.blocked_by_obstacles = true;
-        bullet.destroyed_on_contact = false;
-        game.bullets.push_back(bullet);
-    }
 
-    // BULLETS WHICH DAMAGE PLAYER
-    std::vector<bullet_c> new_bullets;
-    for (unsigned i = 0; i < game.players.size(); i++) {
-//         if (!game.players[i].is_safe_place())
-        for (unsigned j = 0; j < game.bullets.size(); j++) {
-            if (game.bullets[j].damages_player && length(game.players[i].position - game.bullets[j].position) < 1.3) {
-                game.players[i].health -= 10;
-                if (game.players[i].health <= 0) {
-                    game.players[i].position = {4, 30};
-                    game.players[i].health = 100;
-                }
-                if (game.bullets[j].behavior == "c") {
-                    game.players[i].velocity[0] = -80;
-                }
-            } else {
-                new_bullets.push_back(game.bullets[j]);
+            if (game.obstacles_version != obstacles_version) {
+                obstacles = std::make_shared<const std::vector<obstacle_c>>(game.obstacles);
+                obstacles_version = game.obstacles_version;
             }
+            game.views.begin_write().capture(game, tick, start + tick * game.dt, obstacles);
+            game.views.publish();
         }
+        std::this_thread::sleep_until(start + (tick + 1) * game.dt);
     }
-    std::swap(new_bullets,game.bullets);
 }
 
-void process_physics(game_c& game)
+std::array<double, 2> lerp(const std::array<double, 2>& a, const std::array<double, 2>& b, double t)
 {
     using namespace tp::operators;
-    double dt_f = game.dt.count() / 1000.0;
-
-
-    auto old_players = game.players;
-    // update moves
-    for (auto& player : game.players) {
-        player.update(dt_f);
-    }
-
-
-    // update bullets
-    auto old_bullets = game.bullets;
-    std::vector<bullet_c> bullets_new;
-    for (unsigned i = 0; i < game.bullets.size(); i++) {
-        auto &bullet = game.bullets[i];
-        bullet.update(dt_f);
-
-        if (bullet.expired) continue;
-
-        if (!((bullet.position[0] > -10.0) && (bullet.position[0] < 74) && (bullet.position[0] > -1000.0) && (bullet.position[1] < 74))) {
-            continue;
-        }
+    return a + (b - a) * t;
+}
 
-        bool ok = true;
-        if (bullet.blocked_by_obstacles) {
-            for (auto &o : game.obstacles) {
-                double ss = 0.4;
-                if (!(((bullet.position[0]+ss) < o.position[0]) ||
-                    ((bullet.position[0]-ss) > (o.position[0]+o.size[0])) ||
-                    ((bullet.position[1]+ss) < o.position[1]) ||
-                    ((bullet.position[1]-ss) > (o.position[1]+o.size[1])))) {
-                     if (bullet.destroyed_on_contact) {
-                         ok = false;
-                     }
-                     bool contact_left = ((old_bullets[i].position[0]+ss) < o.position[0]);
-                     bool contact_right = ((old_bullets[i].position[0]-ss) > (o.position[0]+o.size[0]));
-                     bool contact_top = ((old_bullets[i].position[1]+ss) < o.position[1]);
-                     bool contact_bottom = ((old_bullets[i].position[1]-ss) > (o.position[1]+o.size[1]));
-                     if ((contact_left || contact_right) && (!contact_top && !contact_bottom)) {
-                         bullet.position[0] = old_bullets[i].position[0];
-                         bullet.velocity[0] = 0;
-                     }
-                     if ((contact_top || contact_bottom) && (!contact_left && !contact_right)) {
-                         bullet.position[1] = old_bullets[i].position[1];
-                         bullet.velocity[1] = 0;
-                         bullet.velocity[0] *= 0.97;
-                     }
-                }
-            }
-        }
-        if (ok) bullets_new.push_back(bullet);
+/// averages of the phases and counters, one line each
+std::string profile_text(const profiler_c::summary_c& summary)
+{
+    char line[64];
+    std::snprintf(line, sizeof(line), "%-17s%7.1f\n", "ticks/s", summary.ticks);
+    std::string text = line;
+    for (int z = 0; z < PROFILE_ZONE_COUNT; z++) {
+        std::snprintf(line, sizeof(line), "%-17s%7.3f ms %5.0f/s\n", profile_zone_names[z], summary.ms[z], summary.calls[z]);
+        text += line;
     }
-    std::swap(bullets_new, game.bullets);
-    
-    // COLLISIONS BETWEEN PLAYERS
-    for (unsigned i = 0; i < game.players.size(); i++) {
-        for (unsigned j = i + 1; j < game.players.size(); j++) {
-            if (length(game.players[i].position - game.players[j].position) < 1.0) {
-                game.players[i].position = old_players[i].position;
-                game.players[j].position = old_players[j].position;
-                auto vec = game.players[i].position - game.players[j].position;
-                vec = vec * (1.0 / length(vec));
-                game.players[i].velocity = vec; //old_players[i].position;
-                game.players[j].velocity = vec * -1.0;
-            }
-        }
+    for (int c = 0; c < PROFILE_COUNTER_COUNT; c++) {
+        std::snprintf(line, sizeof(line), "%-17s%9.0f /tick\n", profile_counter_names[c], summary.counters[c]);
+        text += line;
     }
+    return text;
+}
 
-    // PLAYER COLLISIONS WITH OBSTACLES
-    for (unsigned i = 0; i < game.players.size(); i++) {
-        auto &p = game.players[i];
-        double halfheight = 0;
-        if (p.crouching)
-            halfheight = 0.7;
-        else
-            halfheight = 1.2;
-//         bool contact_top1 = false;
-//         bool contact_bottom1 = false;
-        for (auto &o : game.obstacles) {
-            if (!(((p.position[0]+0.7) < o.position[0]) ||
-                ((p.position[0]-0.7) > (o.position[0]+o.size[0])) ||
-                ((p.position[1]+halfheight) < o.position[1]) ||
-                ((p.position[1]-halfheight) > (o.position[1]+o.size[1])))) {
-                bool contact_left = ((old_players[i].position[0]+0.7) < o.position[0]);
-                bool contact_right = ((old_players[i].position[0]-0.7) > (o.position[0]+o.size[0]));
-                bool contact_top = ((old_players[i].position[1]+halfheight) < o.position[1]);
-                bool contact_bottom = ((old_players[i].position[1]-halfheight) > (o.position[1]+o.size[1]));
-//                 if (contact_top) {
-//                     contact_top1 = true;
-//                 }
-//                 if (contact_bottom) contact_bottom1 = true;
-//                 if (contact_top1 && contact_bottom1) {
-//                     game.players[i].intentions["must_crouch"] = 1;
-//                 }
-                if ((contact_left || contact_right) && (!contact_top && !contact_bottom)) {
-                    p.position[0] = old_players[i].position[0];
-                    p.velocity[0] = 0;
-                }
-                if ((contact_top || contact_bottom) && (!contact_left && !contact_right)) {
-                    p.position[1] = old_players[i].position[1];
-                    p.velocity[1] = 0;
-                    //game.players[i].velocity = {(game.players[i].velocity[0] * game.players[i].velocity[0] > 2.5) ? game.players[i].velocity[0] : 0.0, 0};
-                    if (contact_top) {
-                        game.players[i].on_ground = true;
-                    }
+/// player size i 10 x 10
+void draw_scene(game_c& game)
+{
+    using namespace tp::operators;
+    using namespace std::chrono;
+    auto draw_start = profiler_c::clock::now();
+
+    // the scene one tick in the past, interpolated between the two latest ticks
+    auto [previous, latest] = game.views.acquire();
+    if (!latest) return;
+    if (!previous) previous = latest;
+    double alpha = 1.0;
+    if (latest->time > previous->time) {
+        alpha = duration<double>(steady_clock::now() - game.dt - previous->time) / duration<double>(latest->time - previous->time);
+        alpha = std::clamp(alpha, 0.0, 1.0);
+    }
 
+    // everything is drawn from the atlas, in one batch
+    auto& batch = game.batch;
+
+    // obstacles do not move, so they are rendered into a layer only when they change
+    auto obstacles_start = profiler_c::clock::now();
+    if (game.obstacle_layer.stale(latest->obstacles_version)) {
+        game.obstacle_layer.begin(game.renderer_p.get(), 640, 360);
+        batch.begin(game.atlas);
+        // obstacles are merged rectangles, their texture is repeated on every tile
+        for (auto &o: *latest->obstacles) {
+            for (int y = 0; y < o.size[1]; y++) {
+                for (int x = 0; x < o.size[0]; x++) {
+                    draw_obstacle(batch, (to_double(o.position) + std::array<double, 2>{(double)x, (double)y}) * 10.0, game.atlas.at(o.texture), 10, 10, 0);
                 }
-
             }
         }
+        batch.draw(game.renderer_p.get());
+        game.obstacle_layer.end(game.renderer_p.get(), latest->obstacles_version);
     }
 
-
-
-}
-
-/// player size i 10 x 10
-void draw_scene(game_c& game)
-{
-    using namespace tp::operators;
 //135, 206, 235  	135, 156, 235  	16, 34, 99
     SDL_SetRenderDrawColor(game.renderer_p.get(), 16, 34, 99, 255);
     SDL_RenderClear(game.renderer_p.get());
     SDL_SetRenderDrawColor(game.renderer_p.get(), 255, 100, 200, 255);
 
     // DRAW OBSTACLES
-    for (auto &o: game.obstacles) {
-        draw_obstacle(game.renderer_p, o.position * 10.0, game.textures.at(o.texture), o.size[0]*10, o.size[1]*10, 0);
-    }
+    game.obstacle_layer.draw(game.renderer_p.get(), {0, 0, 640, 360});
+    profiler.add(PROFILE_DRAW_OBSTACLES, obstacles_start, profiler_c::clock::now());
+
+    batch.begin(game.atlas);
 
     // DRAW ALL EMITTERS
 //     for (unsigned i = 0; i < game.emitters.size(); i++) {
 //         auto& emitter = game.emitters[i];
-//         draw_o(game.renderer_p, emitter.position * 10.0, game.textures.at("emitter[0]"), 16, 16, 0.0);
+//         draw_o(batch, emitter.position * 10.0, game.atlas.at("emitter[0]"), 16, 16, 0.0);
 //     }
     // DRAW ALL BULLETS
-    for (unsigned i = 0; i < game.bullets.size(); i++) {
-        auto& bullet = game.bullets[i];
-        draw_o(game.renderer_p, bullet.position * 10.0, game.textures.at(bullet.type), 8, 8, 0);
+    // ids are ascending in both views, bullets spawned since the previous tick are not interpolated
+    auto bullets_start = profiler_c::clock::now();
+    for (unsigned i = 0, j = 0; i < latest->bullet_id.size(); i++) {
+        while (j < previous->bullet_id.size() && previous->bullet_id[j] < latest->bullet_id[i]) j++;
+        auto position = latest->bullet_position[i];
+        if (j < previous->bullet_id.size() && previous->bullet_id[j] == latest->bullet_id[i]) {
+            position = lerp(previous->bullet_position[j], position, alpha);
+        }
+        draw_o(batch, position * 10.0, game.atlas.at(latest->bullet_type[i]), 8, 8, 0);
     }
+    profiler.add(PROFILE_DRAW_BULLETS, bullets_start, profiler_c::clock::now());
 
     // DRAW PLAYER
-    for (unsigned i = 0; i < game.players.size(); i++) {
-        auto& player = game.players[i];
+    for (unsigned i = 0; i < latest->players.size(); i++) {
+        auto& player = latest->players[i];
+        auto position = player.position;
+        if (i < previous->players.size()) position = lerp(previous->players[i].position, position, alpha);
         int height = 16;
         if (!player.crouching) height += 10;
-        draw_o(game.renderer_p, player.position * 10.0, game.textures.at("guy"), 16, height, 0);
+        draw_o(batch, position * 10.0, game.atlas.at(game.sprite_guy), 16, height, 0);
 
         if (player.last_move_left) {
-            draw_o(game.renderer_p, player.position * 10.0, game.textures.at("gun"), 50, 50, player.gun_angle, true);
+            draw_o(batch, position * 10.0, game.atlas.at(game.sprite_gun), 50, 50, player.gun_angle, true);
         }
         else {
-            draw_o(game.renderer_p, player.position * 10.0, game.textures.at("gun"), 50, 50, -player.gun_angle, false);
+            draw_o(batch, position * 10.0, game.atlas.at(game.sprite_gun), 50, 50, -player.gun_angle, false);
         }
 
 //         if (player.is_safe_place())
-//             draw_o(game.renderer_p, player.position * 10.0, game.textures.at("player[" + std::to_string(i) + "]"), 16 + 4, 16 + 4, player.position[0] * 36 + player.position[1] * 5);
+//             draw_o(batch, position * 10.0, game.atlas.at("player[" + std::to_string(i) + "]"), 16 + 4, 16 + 4, position[0] * 36 + position[1] * 5);
+
+        tp::draw_number(batch, 10 + i * 130, 10, game.font_10_red, (int)player.health);
+        //tp::draw_number(batch, 10 + i * 130 + 40, 340, game.font_10_blue, (int)player.points);
+    }
 
-        tp::draw_text(game.renderer_p, 10 + i * 130, 10, game.textures["font_10_red"], std::to_string((int)player.health));
-        //tp::draw_text(game.renderer_p, 10 + i * 130 + 40, 340, game.textures["font_10_blue"], std::to_string((int)player.points));
+    // PROFILER
+    if (game.show_profile) {
+        if (steady_clock::now() - game.profile_time > milliseconds(500)) {
+            game.profile_text = profile_text(profiler.summary());
+            game.profile_time = steady_clock::now();
+        }
+        tp::draw_text(batch, 10, 30, game.font_10, game.profile_text);
     }
 
+    batch.draw(game.renderer_p.get());
+    auto draw_end = profiler_c::clock::now();
+    profiler.add(PROFILE_DRAW, draw_start, draw_end);
     SDL_RenderPresent(game.renderer_p.get());
+    profiler.add(PROFILE_PRESENT, draw_end, profiler_c::clock::now());
 }
 
 
-int main(int, char**)
+/**
+ * usage: gotyapp [--record file] [--trace file]
+ *   --trace writes the profiled phases of the whole session as Chrome trace JSON
+ * */
+int main(int argc, char** argv)
 {
     using namespace std;
     using namespace std::chrono;
 
-    auto game = initialize_all();
-    steady_clock::time_point current_time = steady_clock::now(); // remember current time
-    for (bool game_active = true; game_active;) {
-        game_active = process_input(game);
-        process_events(game);
-        process_physics(game);
-        draw_scene(game);
+    game_c game;
+    initialize_all(game);
+    string trace_file;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        string arg = argv[i];
+        if (arg == "--record") {
+            if (!game.recorder.open(argv[i + 1], game.dt)) cerr << argv[i + 1] << ": can not record" << endl;
+        }
+        else if (arg == "--trace") {
+            trace_file = argv[i + 1];
+        }
+    }
+    profiler.name_thread("render");
+    if (trace_file.size()) profiler.start_trace();
 
-        this_thread::sleep_until(current_time = current_time + game.dt);
+    // the simulation runs at its own pace, the window is redrawn as fast as the display allows
+    thread simulation(simulate, ref(game));
+    while (process_input(game)) {
+        draw_scene(game);
     }
+    game.running = false;
+    simulation.join();
+    game.recorder.close();
+    if (trace_file.size() && !profiler.write_trace(trace_file)) cerr << trace_file << ": can not write the trace" << endl;
+
     SDL_Quit();
     return 0;
 }
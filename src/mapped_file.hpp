@@ -0,0 +1,42 @@
+#ifndef ___MAPPED_FILE_FOR_BULLETHELL_HPP__
+#define ___MAPPED_FILE_FOR_BULLETHELL_HPP__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/// read only view of a whole file
+class mapped_file_c
+{
+public:
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+
+    mapped_file_c(const std::string& file_name)
+    {
+        int fd = open(file_name.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        struct stat st;
+        if ((fstat(fd, &st) == 0) && (st.st_size > 0)) {
+            void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+            if (p != MAP_FAILED) {
+                data = (const uint8_t*)p;
+                size = st.st_size;
+            }
+        }
+        close(fd);
+    }
+    ~mapped_file_c()
+    {
+        if (data) munmap((void*)data, size);
+    }
+    mapped_file_c(const mapped_file_c&) = delete;
+    mapped_file_c& operator=(const mapped_file_c&) = delete;
+};
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef ___PARALLEL_FOR_BULLETHELL_HPP__
+#define ___PARALLEL_FOR_BULLETHELL_HPP__
+
+#include <algorithm>
+#include <cstddef>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/**
+ * helpers for splitting work into contiguous chunks, one chunk per OpenMP thread.
+ *
+ * Loops use
+ *   #pragma omp parallel for schedule(static, 1) num_threads(chunks)
+ *   for (int c = 0; c < chunks; c++) ...
+ * so thread number c processes chunk c, and results of the chunks can be merged
+ * in chunk order - the same order a single thread would produce them in.
+ * */
+namespace tp {
+
+inline int max_threads()
+{
+#ifdef _OPENMP
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
+
+/// later parallel loops started by the calling thread use at most n threads
+inline void limit_threads(int n)
+{
+#ifdef _OPENMP
+    omp_set_num_threads(n);
+#else
+    (void)n;
+#endif
+}
+
+inline int thread_index()
+{
+#ifdef _OPENMP
+    return omp_get_thread_num();
+#else
+    return 0;
+#endif
+}
+
+/// how many chunks n items are worth splitting into, at least grain items in each
+inline int chunk_count(size_t n, size_t grain = 4096)
+{
+    return (int)std::clamp<size_t>(n / grain, 1, max_threads());
+}
+
+/// first item of the chunk c, chunk_begin(n, chunks, chunks) == n
+inline size_t chunk_begin(size_t n, int c, int chunks)
+{
+    return n * c / chunks;
+}
+
+} // namespace tp
+
+#endif
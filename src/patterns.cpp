@@ -0,0 +1,264 @@
+#include "patterns.hpp"
+#include "world.hpp"
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+static real_t radians(real_t degrees)
+{
+    return double(degrees) * M_PI / 180.0;
+}
+
+/// one line of a program, false if it is not a valid op
+static bool compile_op(world_c& game, bool bullet_program, const std::string& command, std::istringstream& ss, pattern_program_c& program)
+{
+    pattern_op_c op;
+    if (bullet_program) {
+        if (command == "accel") {
+            op.op = OP_SET_ACCEL;
+            ss >> op.a >> op.b;
+        }
+        else if (command == "accel_after") {
+            op.op = OP_SET_ACCEL_AFTER;
+            ss >> op.a >> op.b >> op.c;
+        }
+        else if (command == "wrap_time") {
+            op.op = OP_WRAP_TIME;
+            ss >> op.a;
+        }
+        else if (command == "advance_time") {
+            op.op = OP_ADVANCE_TIME;
+        }
+        else if (command == "expire_after") {
+            op.op = OP_EXPIRE_AFTER;
+            ss >> op.a;
+        }
+        else if (command == "integrate") {
+            op.op = OP_INTEGRATE;
+            program.integrate_at = program.ops.size();
+        }
+        else if (command == "clamp_x") {
+            op.op = OP_CLAMP_X;
+            ss >> op.a >> op.b;
+        }
+        else if (command == "clamp_y") {
+            op.op = OP_CLAMP_Y;
+            ss >> op.a >> op.b;
+        }
+        else if (command == "knockback") {
+            program.knockback = true;
+            ss >> program.knockback_velocity;
+            return (bool)ss;
+        }
+        else {
+            return false;
+        }
+    }
+    else {
+        if (command == "bullet") {
+            op.op = OP_BULLET;
+            std::string name, sprite, flag;
+            ss >> name >> sprite >> op.a;
+            int p = pattern_library_c::find(game.patterns.bullets, name);
+            if (p < 0 || !ss) return false;
+            op.program = p;
+            op.sprite = game.sprites.id(sprite);
+            while (ss >> flag) {
+                if (flag == "damages_player") op.flags |= BULLET_DAMAGES_PLAYER;
+                else if (flag == "blocked_by_obstacles") op.flags |= BULLET_BLOCKED_BY_OBSTACLES;
+                else if (flag == "destroyed_on_contact") op.flags |= BULLET_DESTROYED_ON_CONTACT;
+                else return false;
+            }
+            program.ops.push_back(op);
+            return true;
+        }
+        else if (command == "offset") {
+            op.op = OP_OFFSET;
+            ss >> op.a;
+        }
+        else if (command == "shot") {
+            op.op = OP_SHOT;
+            ss >> op.a >> op.b;
+            op.a = radians(op.a);
+        }
+        else if (command == "ring") {
+            op.op = OP_RING;
+            ss >> op.count >> op.a >> op.b;
+            op.a = radians(op.a);
+            if (op.count == 0) return false;
+        }
+        else if (command == "spread") {
+            op.op = OP_SPREAD;
+            ss >> op.count >> op.a >> op.b >> op.c;
+            op.a = radians(op.a);
+            op.b = radians(op.b);
+            if (op.count == 0) return false;
+        }
+        else if (command == "spin") {
+            op.op = OP_SPIN;
+            ss >> op.a;
+            op.a = radians(op.a);
+        }
+        else {
+            return false;
+        }
+    }
+    program.ops.push_back(op);
+    return (bool)ss;
+}
+
+/// picks the kernel of a bullet program, it keeps the VM when its ops do not fit one
+static void compile_kernel(pattern_program_c& program)
+{
+    // the order a kernel runs its features in
+    const std::array<uint8_t, 8> order = {OP_SET_ACCEL, OP_SET_ACCEL_AFTER, OP_WRAP_TIME, OP_ADVANCE_TIME, OP_EXPIRE_AFTER, OP_INTEGRATE, OP_CLAMP_X, OP_CLAMP_Y};
+    size_t next = 0;
+    uint8_t kernel = 0;
+    bool accel_after = false, wrap_time = false;
+    for (auto& op : program.ops) {
+        while (next < order.size() && order[next] != op.op) next++;
+        if (next == order.size()) return;
+        next++;
+        switch (op.op) {
+        case OP_SET_ACCEL:
+            kernel |= KERNEL_ACCEL;
+            program.accel = {op.a, op.b};
+            break;
+        case OP_SET_ACCEL_AFTER:
+            accel_after = true;
+            program.accel_after = op.a;
+            program.accel_after_value = {op.b, op.c};
+            break;
+        case OP_WRAP_TIME:
+            wrap_time = true;
+            program.wrap_time = op.a;
+            break;
+        case OP_ADVANCE_TIME:
+            kernel |= KERNEL_TIME;
+            break;
+        case OP_EXPIRE_AFTER:
+            kernel |= KERNEL_EXPIRE;
+            program.expire_after = op.a;
+            break;
+        case OP_CLAMP_X:
+        case OP_CLAMP_Y:
+            kernel |= KERNEL_CLAMP;
+            program.clamp_min[op.op == OP_CLAMP_Y] = op.a;
+            program.clamp_max[op.op == OP_CLAMP_Y] = op.b;
+            break;
+        default:
+            break;
+        }
+    }
+    if (accel_after != wrap_time) return;
+    if (accel_after) kernel |= KERNEL_OSCILLATE;
+    program.has_kernel = true;
+    program.kernel = kernel;
+}
+
+bool load_patterns(world_c& game, const std::string& file_name)
+{
+    std::ifstream file(file_name);
+    if (!file) return false;
+    pattern_program_c* program = nullptr;
+    bool bullet_program = false;
+    bool has_integrate = false;
+    for (std::string line; std::getline(file, line);) {
+        std::istringstream ss(line);
+        std::string command;
+        ss >> command;
+        if (command.empty() || command[0] == '#') continue;
+        if (program) {
+            if (command == "end") {
+                // every bullet moves, by default after the other ops
+                if (bullet_program && !has_integrate) {
+                    program->integrate_at = program->ops.size();
+                    program->ops.push_back(pattern_op_c{OP_INTEGRATE});
+                }
+                if (bullet_program) compile_kernel(*program);
+                program = nullptr;
+                continue;
+            }
+            has_integrate = has_integrate || (command == "integrate");
+            if (!compile_op(game, bullet_program, command, ss, *program)) return false;
+        }
+        else if (command == "bullet" || command == "emitter") {
+            bullet_program = (command == "bullet");
+            auto& programs = bullet_program ? game.patterns.bullets : game.patterns.emitters;
+            std::string name;
+            ss >> name;
+            if (name.empty() || pattern_library_c::find(programs, name) >= 0) return false;
+            // bullets store their program in a byte
+            if (bullet_program && programs.size() > 255) return false;
+            programs.push_back(pattern_program_c());
+            program = &programs.back();
+            program->name = name;
+            has_integrate = false;
+        }
+        else if (command == "gun") {
+            std::string name;
+            ss >> name;
+            int p = pattern_library_c::find(game.patterns.emitters, name);
+            if (p < 0) return false;
+            game.gun_pattern = p;
+        }
+        else {
+            return false;
+        }
+    }
+    return program == nullptr;
+}
+
+void fire_pattern(world_c& game, const pattern_program_c& program, vec2_t origin, real_t angle, vec2_t velocity, real_t& spin)
+{
+    using std::cos;
+    using std::sin;
+    bullet_c bullet;
+    bullet.position = {0.0, 0.0};
+    bullet.velocity = {0.0, 0.0};
+    bullet.acceleration = {0.0, 0.0};
+    bullet.friction = 0.0;
+    real_t offset = 0;
+    auto& bullets = game.bullets;
+    // count bullets, the k-th in direction first + k * step
+    auto burst = [&](size_t count, real_t first, real_t step, real_t speed) {
+        size_t i = bullets.spawn(bullet, count);
+        for (size_t k = 0; k < count; k++, i++) {
+            real_t a = angle + spin + first + real_t(k) * step;
+            vec2_t direction = {cos(a), sin(a)};
+            bullets.position[i] = {origin[0] + direction[0] * offset, origin[1] + direction[1] * offset};
+            bullets.previous_position[i] = bullets.position[i];
+            bullets.velocity[i] = {direction[0] * speed + velocity[0], direction[1] * speed + velocity[1]};
+        }
+    };
+    for (auto& op : program.ops) {
+        switch (op.op) {
+        case OP_BULLET:
+            bullet.program = op.program;
+            bullet.type = op.sprite;
+            bullet.friction = op.a;
+            bullet.damages_player = op.flags & BULLET_DAMAGES_PLAYER;
+            bullet.blocked_by_obstacles = op.flags & BULLET_BLOCKED_BY_OBSTACLES;
+            bullet.destroyed_on_contact = op.flags & BULLET_DESTROYED_ON_CONTACT;
+            break;
+        case OP_OFFSET:
+            offset = op.a;
+            break;
+        case OP_SHOT:
+            burst(1, op.a, 0, op.b);
+            break;
+        case OP_RING:
+            burst(op.count, op.a, 2 * M_PI / op.count, op.b);
+            break;
+        case OP_SPREAD:
+            if (op.count > 1) burst(op.count, op.a - op.b / 2, op.b / (op.count - 1), op.c);
+            else burst(op.count, op.a, 0, op.c);
+            break;
+        case OP_SPIN:
+            spin += op.a;
+            break;
+        default:
+            break;
+        }
+    }
+}
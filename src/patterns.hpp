@@ -0,0 +1,121 @@
+#ifndef ___PATTERNS_FOR_BULLETHELL_HPP__
+#define ___PATTERNS_FOR_BULLETHELL_HPP__
+
+#include "precision.hpp"
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class world_c;
+
+/**
+ * bullet patterns - small programs compiled from data/patterns.txt.
+ *
+ * A bullet program runs every tick over all the bullets which have it, one op at
+ * a time, so there is no per bullet dispatch. An emitter program runs every time
+ * the emitter fires and spawns its bullets in batches.
+ * */
+enum pattern_op_e : uint8_t {
+    // bullet programs, a is x and b is y where it is a vector
+    OP_SET_ACCEL,       // acceleration = (a, b)
+    OP_SET_ACCEL_AFTER, // acceleration = (b, c) when time > a
+    OP_WRAP_TIME,       // time = 0 when time > a
+    OP_ADVANCE_TIME,    // time += dt
+    OP_EXPIRE_AFTER,    // expired when time > a
+    OP_INTEGRATE,       // basic physics, every bullet moves once per tick
+    OP_CLAMP_X,         // x kept in [a, b]
+    OP_CLAMP_Y,         // y kept in [a, b]
+
+    // emitter programs, angles are in radians, 0 is to the right and pi/2 down
+    OP_BULLET, // bullets spawned from now on run program with sprite, flags and friction a
+    OP_OFFSET, // bullets spawned from now on start a away from the emitter, in their direction
+    OP_SHOT,   // one bullet at angle a, speed b
+    OP_RING,   // count bullets evenly around, the first at angle a, speed b
+    OP_SPREAD, // count bullets over an arc of b centered at angle a, speed c
+    OP_SPIN,   // every later shot of the emitter is turned by a more (spirals)
+};
+
+/**
+ * what a bullet kernel does - a kernel is the whole bullet program compiled into
+ * one loop, with the features it does not have left out at compile time. Programs
+ * are run by a kernel when their ops are in the order of the features here (each
+ * at most once), else by the VM.
+ * */
+enum bullet_kernel_e : uint8_t {
+    KERNEL_ACCEL = 1,     // accel
+    KERNEL_OSCILLATE = 2, // accel_after and wrap_time
+    KERNEL_TIME = 4,      // advance_time
+    KERNEL_EXPIRE = 8,    // expire_after
+    KERNEL_CLAMP = 16,    // clamp_x and clamp_y after integrate, the missing one unbounded
+    KERNEL_DRAG = 32,     // not part of the program - for the bullets with friction
+    KERNEL_COUNT = 64
+};
+
+/// one instruction with its operands inline
+class pattern_op_c
+{
+public:
+    uint8_t op;
+    uint8_t flags = 0;    // OP_BULLET: bullet_flags_e
+    uint16_t sprite = 0;  // OP_BULLET
+    uint16_t program = 0; // OP_BULLET: bullet program
+    uint16_t count = 1;   // OP_RING, OP_SPREAD
+    real_t a = 0;
+    real_t b = 0;
+    real_t c = 0;
+};
+
+class pattern_program_c
+{
+public:
+    std::string name; // only for looking programs up while loading
+    std::vector<pattern_op_c> ops;
+    /// bullet programs: ops before it run before the bullets move, the rest after
+    size_t integrate_at = 0;
+    /// bullet programs: horizontal velocity of a player hit by the bullet
+    bool knockback = false;
+    real_t knockback_velocity = 0;
+
+    /// bullet programs: bullet_kernel_e features of the kernel which runs the program
+    bool has_kernel = false;
+    uint8_t kernel = 0;
+    // operands of the kernel
+    vec2_t accel = {0, 0};
+    real_t accel_after = 0;
+    vec2_t accel_after_value = {0, 0};
+    real_t wrap_time = 0;
+    real_t expire_after = 0;
+    vec2_t clamp_min = {-unbounded<real_t>(), -unbounded<real_t>()};
+    vec2_t clamp_max = {unbounded<real_t>(), unbounded<real_t>()};
+};
+
+class pattern_library_c
+{
+public:
+    std::vector<pattern_program_c> bullets;
+    std::vector<pattern_program_c> emitters;
+
+    /// index of the program with the name, -1 if there is none
+    static int find(const std::vector<pattern_program_c>& programs, const std::string& name)
+    {
+        for (unsigned i = 0; i < programs.size(); i++) {
+            if (programs[i].name == name) return i;
+        }
+        return -1;
+    }
+};
+
+/**
+ * compiles the programs of a pattern file (see data/patterns.txt) into the world,
+ * false if it can not be read or has an error
+ * */
+bool load_patterns(world_c& game, const std::string& file_name);
+
+/**
+ * runs an emitter program - spawns its bullets from origin, with every angle turned
+ * by angle and velocity added to theirs. OP_SPIN turns spin.
+ * */
+void fire_pattern(world_c& game, const pattern_program_c& program, vec2_t origin, real_t angle, vec2_t velocity, real_t& spin);
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef ___PRECISION_FOR_BULLETHELL_HPP__
+#define ___PRECISION_FOR_BULLETHELL_HPP__
+
+#include "fixed.hpp"
+#include "vectors.hpp"
+#include <array>
+#include <cstdint>
+#include <limits>
+
+/**
+ * the numbers the simulation runs on, chosen when building (GOTY_PRECISION in
+ * CMake): double, float (half the memory per bullet, twice the values per SIMD
+ * register) or fixed_c (bit exact on every compiler and machine).
+ *
+ * The physics classes are templates over the scalar, the world uses real_t.
+ * */
+enum precision_e : uint32_t {
+    PRECISION_DOUBLE,
+    PRECISION_FLOAT,
+    PRECISION_FIXED,
+    PRECISION_COUNT
+};
+
+inline const std::array<const char*, PRECISION_COUNT> precision_names = {"double", "float", "fixed"};
+
+#if defined(GOTY_PRECISION_FIXED)
+using real_t = fixed_c;
+constexpr precision_e precision = PRECISION_FIXED;
+#elif defined(GOTY_PRECISION_FLOAT)
+using real_t = float;
+constexpr precision_e precision = PRECISION_FLOAT;
+#else
+using real_t = double;
+constexpr precision_e precision = PRECISION_DOUBLE;
+#endif
+
+using vec2_t = tp::vec2_c<real_t>;
+
+/// the largest value, infinity when there is one
+template <typename T>
+constexpr T unbounded()
+{
+    if constexpr (std::numeric_limits<T>::has_infinity) return std::numeric_limits<T>::infinity();
+    else return std::numeric_limits<T>::max();
+}
+
+/// for the renderer and for printing
+template <typename T>
+inline std::array<double, 2> to_double(const tp::vec2_c<T>& v)
+{
+    return {double(v[0]), double(v[1])};
+}
+
+#endif
@@ -0,0 +1,147 @@
+#include "profiler.hpp"
+#include <cstdio>
+#include <fstream>
+
+profiler_c profiler;
+
+profiler_c::thread_c* profiler_c::add_thread()
+{
+    std::lock_guard<std::mutex> lock(threads_mutex);
+    threads.push_back(std::make_unique<thread_c>());
+    threads.back()->index = threads.size();
+    threads.back()->name = "thread " + std::to_string(threads.size());
+    return threads.back().get();
+}
+
+void profiler_c::name_thread(const std::string& name)
+{
+    auto& t = local();
+    std::lock_guard<std::mutex> lock(threads_mutex);
+    t.name = name;
+}
+
+void profiler_c::trace(thread_c& t, profile_zone_e zone, clock::time_point start, clock::time_point end)
+{
+    std::lock_guard<std::mutex> lock(t.trace_mutex);
+    if (t.events.size() < max_events) t.events.push_back({zone, start, end});
+}
+
+std::array<uint64_t, PROFILE_COUNTER_COUNT> profiler_c::counter_totals()
+{
+    std::array<uint64_t, PROFILE_COUNTER_COUNT> totals = {};
+    std::lock_guard<std::mutex> lock(threads_mutex);
+    for (auto& t : threads) {
+        for (int c = 0; c < PROFILE_COUNTER_COUNT; c++) totals[c] += t->counters[c].load(std::memory_order_relaxed);
+    }
+    return totals;
+}
+
+void profiler_c::end_tick()
+{
+    ticks.fetch_add(1, std::memory_order_relaxed);
+    if (!tracing.load(std::memory_order_relaxed)) return;
+    auto totals = counter_totals();
+    std::lock_guard<std::mutex> lock(tick_mutex);
+    counter_event_c e;
+    e.time = clock::now();
+    for (int c = 0; c < PROFILE_COUNTER_COUNT; c++) e.counters[c] = totals[c] - tick_counters[c];
+    tick_counters = totals;
+    if (counter_events.size() < max_events) counter_events.push_back(e);
+}
+
+profiler_c::summary_c profiler_c::summary()
+{
+    summary_c s;
+    std::array<uint64_t, PROFILE_ZONE_COUNT> ns = {}, calls = {};
+    {
+        std::lock_guard<std::mutex> lock(threads_mutex);
+        for (auto& t : threads) {
+            for (int z = 0; z < PROFILE_ZONE_COUNT; z++) {
+                ns[z] += t->zone_ns[z].load(std::memory_order_relaxed);
+                calls[z] += t->zone_calls[z].load(std::memory_order_relaxed);
+            }
+        }
+    }
+    auto counters = counter_totals();
+    uint64_t tick_count = ticks.load(std::memory_order_relaxed);
+    auto now = clock::now();
+    double seconds = std::chrono::duration<double>(now - summary_time).count();
+
+    for (int z = 0; z < PROFILE_ZONE_COUNT; z++) {
+        uint64_t n = calls[z] - summary_calls[z];
+        if (n) s.ms[z] = (ns[z] - summary_ns[z]) / 1e6 / n;
+        if (seconds > 0) s.calls[z] = n / seconds;
+    }
+    uint64_t n = tick_count - summary_ticks;
+    for (int c = 0; c < PROFILE_COUNTER_COUNT; c++) {
+        if (n) s.counters[c] = (double)(counters[c] - summary_counters[c]) / n;
+    }
+    if (seconds > 0) s.ticks = n / seconds;
+
+    summary_time = now;
+    summary_ticks = tick_count;
+    summary_ns = ns;
+    summary_calls = calls;
+    summary_counters = counters;
+    return s;
+}
+
+void profiler_c::start_trace()
+{
+    {
+        std::lock_guard<std::mutex> lock(threads_mutex);
+        for (auto& t : threads) {
+            std::lock_guard<std::mutex> trace_lock(t->trace_mutex);
+            t->events.clear();
+        }
+    }
+    auto totals = counter_totals();
+    {
+        // end_tick uses both on the simulation thread, also while a trace runs
+        std::lock_guard<std::mutex> lock(tick_mutex);
+        counter_events.clear();
+        tick_counters = totals;
+    }
+    trace_start = clock::now();
+    tracing = true;
+}
+
+bool profiler_c::write_trace(const std::string& file_name)
+{
+    tracing = false;
+    std::ofstream file(file_name);
+    if (!file) return false;
+    // microseconds since the trace started
+    auto us = [&](clock::time_point t) { return std::chrono::duration<double, std::micro>(t - trace_start).count(); };
+    char line[256];
+    const char* separator = "";
+    file << "{\"traceEvents\":[";
+
+    std::lock_guard<std::mutex> lock(threads_mutex);
+    for (auto& t : threads) {
+        std::lock_guard<std::mutex> trace_lock(t->trace_mutex);
+        if (t->events.empty()) continue;
+        std::snprintf(line, sizeof(line), "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+            separator, t->index, t->name.c_str());
+        file << line;
+        separator = ",";
+        for (auto& e : t->events) {
+            std::snprintf(line, sizeof(line), ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                profile_zone_names[e.zone], t->index, us(e.start), us(e.end) - us(e.start));
+            file << line;
+        }
+        t->events.clear();
+    }
+    std::lock_guard<std::mutex> tick_lock(tick_mutex);
+    for (auto& e : counter_events) {
+        for (int c = 0; c < PROFILE_COUNTER_COUNT; c++) {
+            std::snprintf(line, sizeof(line), "%s\n{\"name\":\"%s\",\"ph\":\"C\",\"pid\":1,\"ts\":%.3f,\"args\":{\"value\":%llu}}",
+                separator, profile_counter_names[c], us(e.time), (unsigned long long)e.counters[c]);
+            file << line;
+            separator = ",";
+        }
+    }
+    counter_events.clear();
+    file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    return (bool)file;
+}
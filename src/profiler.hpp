@@ -0,0 +1,179 @@
+#ifndef ___PROFILER_FOR_BULLETHELL_HPP__
+#define ___PROFILER_FOR_BULLETHELL_HPP__
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/// timed phases of a frame and of a simulation tick
+enum profile_zone_e : uint8_t {
+    PROFILE_INPUT,
+    PROFILE_EVENTS,
+    PROFILE_SHOOTING,
+    PROFILE_DAMAGE,
+    PROFILE_PHYSICS,
+    PROFILE_BULLET_UPDATE,
+    PROFILE_BULLET_COLLISION,
+    PROFILE_PLAYER_COLLISION,
+    PROFILE_DRAW,
+    PROFILE_DRAW_OBSTACLES,
+    PROFILE_DRAW_BULLETS,
+    PROFILE_PRESENT,
+    PROFILE_ZONE_COUNT
+};
+
+inline const std::array<const char*, PROFILE_ZONE_COUNT> profile_zone_names = {
+    "process_input", "process_events", "shooting", "damage", "process_physics", "bullet update",
+    "bullet collision", "player collision", "draw_scene", "draw obstacles", "draw bullets", "present"};
+
+/// things counted by the simulation, summed over a tick
+enum profile_counter_e : uint8_t {
+    COUNTER_BULLETS,
+    COUNTER_PLAYERS,
+    COUNTER_EMITTERS,
+    COUNTER_OBSTACLE_TESTS,
+    COUNTER_DAMAGE_TESTS,
+    PROFILE_COUNTER_COUNT
+};
+
+inline const std::array<const char*, PROFILE_COUNTER_COUNT> profile_counter_names = {
+    "bullets", "players", "emitters", "obstacle tests", "damage tests"};
+
+/**
+ * frame profiler - scoped timers around the phases and counters of the simulation.
+ *
+ * Every thread adds to its own totals, so timing a zone is two clock reads and
+ * two stores, with no locks and no shared cache lines. summary() reads the totals
+ * of all threads. While a trace is recorded every zone is also kept as an event
+ * and written as Chrome trace JSON (chrome://tracing, ui.perfetto.dev).
+ * */
+class profiler_c
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+    /// averages since the summary before
+    class summary_c
+    {
+    public:
+        std::array<double, PROFILE_ZONE_COUNT> ms = {};          // per call
+        std::array<double, PROFILE_ZONE_COUNT> calls = {};       // per second
+        std::array<double, PROFILE_COUNTER_COUNT> counters = {}; // per tick
+        double ticks = 0;                                        // per second
+    };
+
+    void add(profile_zone_e zone, clock::time_point start, clock::time_point end)
+    {
+        auto& t = local();
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+        // only this thread writes its totals, others just read them
+        t.zone_ns[zone].store(t.zone_ns[zone].load(std::memory_order_relaxed) + ns, std::memory_order_relaxed);
+        t.zone_calls[zone].store(t.zone_calls[zone].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        if (tracing.load(std::memory_order_relaxed)) trace(t, zone, start, end);
+    }
+
+    void count(profile_counter_e counter, uint64_t n)
+    {
+        auto& c = local().counters[counter];
+        c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    /// the simulation finished a tick - counters are averaged over ticks and traced per tick
+    void end_tick();
+
+    /// name of the calling thread in traces
+    void name_thread(const std::string& name);
+
+    summary_c summary();
+
+    /// starts keeping events, the ones of an earlier trace are dropped
+    void start_trace();
+    /// stops keeping events and writes them, false if the file can not be written
+    bool write_trace(const std::string& file_name);
+    bool is_tracing() const { return tracing.load(std::memory_order_relaxed); }
+
+private:
+    class event_c
+    {
+    public:
+        profile_zone_e zone;
+        clock::time_point start;
+        clock::time_point end;
+    };
+
+    class counter_event_c
+    {
+    public:
+        clock::time_point time;
+        std::array<uint64_t, PROFILE_COUNTER_COUNT> counters;
+    };
+
+    class alignas(64) thread_c
+    {
+    public:
+        int index;
+        std::string name;
+        std::array<std::atomic<uint64_t>, PROFILE_ZONE_COUNT> zone_ns = {};
+        std::array<std::atomic<uint64_t>, PROFILE_ZONE_COUNT> zone_calls = {};
+        std::array<std::atomic<uint64_t>, PROFILE_COUNTER_COUNT> counters = {};
+        std::mutex trace_mutex;
+        std::vector<event_c> events;
+    };
+
+    /// events per thread, older ones are kept and the rest dropped
+    static constexpr size_t max_events = 1 << 20;
+
+    std::mutex threads_mutex;
+    std::vector<std::unique_ptr<thread_c>> threads;
+    std::atomic<bool> tracing{false};
+    std::atomic<uint64_t> ticks{0};
+    clock::time_point trace_start;
+
+    // state of the summary before
+    clock::time_point summary_time = clock::now();
+    uint64_t summary_ticks = 0;
+    std::array<uint64_t, PROFILE_ZONE_COUNT> summary_ns = {};
+    std::array<uint64_t, PROFILE_ZONE_COUNT> summary_calls = {};
+    std::array<uint64_t, PROFILE_COUNTER_COUNT> summary_counters = {};
+
+    // counter values at the end of ticks, while tracing
+    std::mutex tick_mutex;
+    std::array<uint64_t, PROFILE_COUNTER_COUNT> tick_counters = {};
+    std::vector<counter_event_c> counter_events;
+
+    thread_c& local()
+    {
+        thread_local thread_c* t = nullptr;
+        if (!t) t = add_thread();
+        return *t;
+    }
+    thread_c* add_thread();
+    void trace(thread_c& t, profile_zone_e zone, clock::time_point start, clock::time_point end);
+    std::array<uint64_t, PROFILE_COUNTER_COUNT> counter_totals();
+};
+
+/// the one profiler of the process, shared by all the threads
+extern profiler_c profiler;
+
+/**
+ * times the rest of the block
+ * */
+class profile_scope_c
+{
+public:
+    explicit profile_scope_c(profile_zone_e zone_) : zone(zone_), start(profiler_c::clock::now()) {}
+    ~profile_scope_c() { profiler.add(zone, start, profiler_c::clock::now()); }
+    profile_scope_c(const profile_scope_c&) = delete;
+    profile_scope_c& operator=(const profile_scope_c&) = delete;
+
+private:
+    profile_zone_e zone;
+    profiler_c::clock::time_point start;
+};
+
+#endif
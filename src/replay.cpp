@@ -0,0 +1,93 @@
+#include "replay.hpp"
+#include "rollback.hpp"
+#include "simulation.hpp"
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+ * replays a session recorded with gotyapp --record, as fast as possible and
+ * without a window, and checks the recorded state hashes. Every tick is also
+ * pushed into a rollback ring (as in the game), which is rewound tick by tick
+ * at the end and has to give back the state of each tick.
+ *
+ * usage: gotyreplay file
+ *   exits with 1 if the file can not be read, the replay went different or
+ *   the rollback did not restore a tick
+ * */
+int main(int argc, char** argv)
+{
+    using namespace std::chrono;
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " file" << std::endl;
+        return 1;
+    }
+    input_replay_c replay;
+    if (!replay.open(argv[1])) {
+        std::cerr << argv[1] << ": not a recorded session" << std::endl;
+        return 1;
+    }
+
+    world_c game;
+    initialize_world(game);
+    game.dt = replay.dt;
+
+    long ticks = 0;
+    long hashes = 0;
+    long mismatches = 0;
+    rollback_c rollback;
+    // state hash of the ticks the ring can hold, by tick
+    std::vector<uint64_t> tick_hashes(1024);
+    auto step = [&]() {
+        apply_intents(game, replay.intents);
+        process_events(game);
+        process_physics(game);
+        ticks++;
+        rollback.push(game, ticks);
+        tick_hashes[ticks % tick_hashes.size()] = state_hash(game);
+    };
+
+    steady_clock::time_point start = steady_clock::now();
+    while (replay.read()) {
+        for (uint64_t i = 0; i < replay.repeat; i++) step();
+        if (replay.kind == REPLAY_INTENTS) {
+            replay.intents = replay.next;
+            step();
+        }
+        else if (replay.kind == REPLAY_HASH) {
+            hashes++;
+            if (state_hash(game) != replay.hash) {
+                if (!mismatches) std::cerr << "state differs from the recording at tick " << ticks << std::endl;
+                mismatches++;
+            }
+        }
+        else {
+            break;
+        }
+    }
+    double seconds = duration<double>(steady_clock::now() - start).count();
+
+    // rewind through the whole ring, like holding the rewind key in the game
+    long rewound = 0;
+    long rollback_mismatches = 0;
+    if (!rollback.empty()) {
+        for (uint64_t t = rollback.newest(); t >= rollback.oldest() && t > 0; t--, rewound++) {
+            if (!rollback.restore(game, t) || state_hash(game) != tick_hashes[t % tick_hashes.size()]) {
+                if (!rollback_mismatches) std::cerr << "rollback does not restore tick " << t << std::endl;
+                rollback_mismatches++;
+            }
+        }
+        if (rollback.oldest() > 1 && rollback.restore(game, rollback.oldest() - 1)) {
+            std::cerr << "rollback restored tick " << rollback.oldest() - 1 << " which is no longer held" << std::endl;
+            rollback_mismatches++;
+        }
+    }
+
+    if (replay.corrupted()) std::cerr << argv[1] << ": truncated or corrupted, replayed " << ticks << " ticks" << std::endl;
+    std::cout << ticks << " ticks (" << ticks * game.dt.count() / 1000.0 << " s of game time) in "
+              << seconds << " s, " << ticks / seconds << " ticks/s" << std::endl;
+    std::cout << "hashes: " << hashes - mismatches << " of " << hashes << " match" << std::endl;
+    std::cout << "rollback: " << rewound - rollback_mismatches << " of " << rewound << " ticks restored" << std::endl;
+    return (mismatches || rollback_mismatches || replay.corrupted()) ? 1 : 0;
+}
@@ -0,0 +1,233 @@
+#ifndef ___REPLAY_FOR_BULLETHELL_HPP__
+#define ___REPLAY_FOR_BULLETHELL_HPP__
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * recorded sessions - the intents of every player for every tick, and state
+ * hashes to check the replay against.
+ *
+ * The file starts with "GOTYREC", a version byte and the tick length in ms as a
+ * varint. Then come records, each a varint (repeat << 2 | kind):
+ *  - REPLAY_INTENTS: the previous intents stay for repeat ticks, then one tick
+ *    with new intents - a varint player count and per player a varint of the
+ *    intents xor the previous ones
+ *  - REPLAY_HASH: repeat ticks as above, then the 8 byte state_hash after them
+ *  - REPLAY_END: repeat ticks as above, and the end of the session
+ * Holding a key costs nothing, a change costs a few bytes.
+ * */
+enum replay_record_e : uint8_t {
+    REPLAY_INTENTS = 0,
+    REPLAY_HASH = 1,
+    REPLAY_END = 2,
+};
+
+static const char replay_magic[8] = "GOTYREC";
+static const uint8_t replay_version = 1;
+
+/**
+ * encodes the session on the simulation thread, the file is written by a
+ * background thread so a slow disk never delays a tick
+ * */
+class input_recorder_c
+{
+public:
+    ~input_recorder_c() { close(); }
+
+    bool open(const std::string& file_name, std::chrono::milliseconds dt)
+    {
+        file.open(file_name, std::ios::binary);
+        if (!file) return false;
+        buffer.assign(replay_magic, replay_magic + sizeof(replay_magic) - 1);
+        buffer.push_back(replay_version);
+        put_varint(dt.count());
+        last.clear();
+        repeat = 0;
+        closing = false;
+        writer = std::thread([this]() { write_loop(); });
+        return true;
+    }
+
+    bool is_open() const { return writer.joinable(); }
+
+    /// intents for the next tick
+    void record(const std::vector<uint32_t>& intents)
+    {
+        if (intents == last) {
+            repeat++;
+            return;
+        }
+        put_varint((repeat << 2) | REPLAY_INTENTS);
+        put_varint(intents.size());
+        for (unsigned i = 0; i < intents.size(); i++) {
+            put_varint(intents[i] ^ ((i < last.size()) ? last[i] : 0));
+        }
+        last = intents;
+        repeat = 0;
+        hand_over(false);
+    }
+
+    /// state_hash after the ticks recorded so far
+    void hash(uint64_t h)
+    {
+        put_varint((repeat << 2) | REPLAY_HASH);
+        for (int i = 0; i < 8; i++) buffer.push_back(h >> (i * 8));
+        repeat = 0;
+        hand_over(false);
+    }
+
+    void close()
+    {
+        if (!is_open()) return;
+        put_varint((repeat << 2) | REPLAY_END);
+        hand_over(true);
+        writer.join();
+        file.close();
+    }
+
+private:
+    std::ofstream file;
+    std::vector<uint8_t> buffer;
+    std::vector<uint32_t> last;
+    uint64_t repeat = 0;
+
+    // shared with the writer thread
+    std::mutex m;
+    std::condition_variable cv;
+    std::vector<uint8_t> pending;
+    bool closing = false;
+    std::thread writer;
+
+    void put_varint(uint64_t v)
+    {
+        while (v >= 0x80) {
+            buffer.push_back((v & 0x7f) | 0x80);
+            v >>= 7;
+        }
+        buffer.push_back(v);
+    }
+
+    /// the encoded bytes go to the writer in blocks
+    void hand_over(bool last_block)
+    {
+        if (!last_block && buffer.size() < 4096) return;
+        {
+            std::lock_guard<std::mutex> lock(m);
+            pending.insert(pending.end(), buffer.begin(), buffer.end());
+            closing = last_block;
+        }
+        buffer.clear();
+        cv.notify_one();
+    }
+
+    void write_loop()
+    {
+        std::vector<uint8_t> block;
+        for (bool done = false; !done;) {
+            {
+                std::unique_lock<std::mutex> lock(m);
+                cv.wait(lock, [this]() { return closing || !pending.empty(); });
+                std::swap(block, pending);
+                done = closing;
+            }
+            file.write((const char*)block.data(), block.size());
+            block.clear();
+        }
+        file.flush();
+    }
+};
+
+/**
+ * reads a recorded session back, record by record:
+ *
+ *     for (replay.repeat) step with replay.intents
+ *     REPLAY_INTENTS: replay.intents = replay.next, step once
+ *     REPLAY_HASH: compare state_hash with the recorded one
+ * */
+class input_replay_c
+{
+public:
+    std::chrono::milliseconds dt;
+
+    replay_record_e kind;
+    uint64_t repeat;
+    std::vector<uint32_t> intents; // for the repeated ticks
+    std::vector<uint32_t> next;    // new intents of REPLAY_INTENTS
+    uint64_t hash;
+
+    bool open(const std::string& file_name)
+    {
+        std::ifstream file(file_name, std::ios::binary);
+        if (!file) return false;
+        data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        if (data.size() < sizeof(replay_magic)) return false;
+        if (std::memcmp(data.data(), replay_magic, sizeof(replay_magic) - 1) != 0) return false;
+        if (data[sizeof(replay_magic) - 1] != replay_version) return false;
+        at = sizeof(replay_magic);
+        dt = std::chrono::milliseconds(get_varint());
+        intents.clear();
+        next.clear();
+        return !corrupted();
+    }
+
+    /// next record, false after REPLAY_END or at the end of a truncated file
+    bool read()
+    {
+        if (at >= data.size()) return false;
+        uint64_t header = get_varint();
+        kind = (replay_record_e)(header & 3);
+        repeat = header >> 2;
+        if (kind == REPLAY_INTENTS) {
+            size_t n = get_varint();
+            if (corrupted() || n > data.size()) return false;
+            next.assign(n, 0);
+            for (unsigned i = 0; i < n; i++) next[i] = get_varint() ^ ((i < intents.size()) ? intents[i] : 0);
+        }
+        else if (kind == REPLAY_HASH) {
+            hash = 0;
+            for (int i = 0; i < 8; i++) hash |= (uint64_t)get_byte() << (i * 8);
+        }
+        else if (kind != REPLAY_END) {
+            at = data.size() + 1;
+        }
+        return !corrupted();
+    }
+
+    bool corrupted() const { return at > data.size(); }
+
+private:
+    std::vector<uint8_t> data;
+    size_t at = 0;
+
+    uint8_t get_byte()
+    {
+        if (at >= data.size()) {
+            at = data.size() + 1;
+            return 0;
+        }
+        return data[at++];
+    }
+
+    uint64_t get_varint()
+    {
+        uint64_t v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            uint8_t b = get_byte();
+            v |= (uint64_t)(b & 0x7f) << shift;
+            if (!(b & 0x80)) return v;
+        }
+        at = data.size() + 1;
+        return 0;
+    }
+};
+
+#endif
@@ -0,0 +1,239 @@
+#include "rollback.hpp"
+#include <cstring>
+#include <type_traits>
+
+static_assert(std::is_trivially_copyable<player_c>::value, "players are compared and copied as bytes");
+static_assert(std::is_trivially_copyable<emitter_c>::value, "emitters are compared and copied as bytes");
+
+/// bit exact, so the restored state replays exactly like the original
+template <typename T>
+static bool same(const T& a, const T& b)
+{
+    return std::memcmp(&a, &b, sizeof(T)) == 0;
+}
+
+static void append(bullet_pool_c& to, const bullet_pool_c& from, size_t i)
+{
+    to.position.push_back(from.position[i]);
+    to.previous_position.push_back(from.previous_position[i]);
+    to.velocity.push_back(from.velocity[i]);
+    to.acceleration.push_back(from.acceleration[i]);
+    to.friction.push_back(from.friction[i]);
+    to.time.push_back(from.time[i]);
+    to.type.push_back(from.type[i]);
+    to.program.push_back(from.program[i]);
+    to.flags.push_back(from.flags[i]);
+    to.id.push_back(from.id[i]);
+}
+
+/// changed entities of one kind - all when the count differs from the last tick
+template <typename T>
+static void delta_entities(const std::vector<T>& current, const std::vector<T>& last, uint32_t& count, std::vector<uint32_t>& index, std::vector<T>& changed)
+{
+    count = current.size();
+    index.clear();
+    changed.clear();
+    for (uint32_t i = 0; i < current.size(); i++) {
+        if (i >= last.size() || !same(current[i], last[i])) {
+            index.push_back(i);
+            changed.push_back(current[i]);
+        }
+    }
+}
+
+template <typename T>
+static void apply_entities(std::vector<T>& current, uint32_t count, const std::vector<uint32_t>& index, const std::vector<T>& changed)
+{
+    current.resize(count);
+    for (size_t k = 0; k < index.size(); k++) {
+        current[index[k]] = changed[k];
+    }
+}
+
+rollback_c::rollback_c(unsigned ticks, unsigned keyframe_interval_)
+{
+    keyframe_interval = std::max(1u, keyframe_interval_);
+    unsigned keyframes = std::max(1u, (ticks + keyframe_interval - 1) / keyframe_interval);
+    frames.resize(keyframes * keyframe_interval);
+}
+
+uint64_t rollback_c::oldest() const
+{
+    // the first keyframe at or after the lowest intact frame
+    return first_tick + (lowest_tick - first_tick + keyframe_interval - 1) / keyframe_interval * keyframe_interval;
+}
+
+void rollback_c::push(const world_c& game, uint64_t tick)
+{
+    if (!started || tick != newest_tick + 1) {
+        first_tick = lowest_tick = tick;
+        started = true;
+    }
+    // the slot of tick held tick - frames.size() (unless it was dropped by a restore)
+    if (tick - lowest_tick >= frames.size()) lowest_tick = tick + 1 - frames.size();
+    frame_c& f = frame(tick);
+    f.tick = tick;
+    f.next_id = game.bullets.next_id;
+    f.keyframe = ((tick - first_tick) % keyframe_interval == 0);
+    if (f.keyframe) {
+        f.player_count = game.players.size();
+        f.players = game.players;
+        f.emitter_count = game.emitters.size();
+        f.emitters = game.emitters;
+        f.bullets = game.bullets;
+    }
+    else {
+        make_delta(f, game);
+    }
+    newest_tick = tick;
+    remember(game);
+}
+
+bool rollback_c::restore(world_c& game, uint64_t tick)
+{
+    if (empty() || tick < oldest() || tick > newest_tick) return false;
+    uint64_t key = tick - (tick - first_tick) % keyframe_interval;
+    const frame_c& k = frame(key);
+    game.players = k.players;
+    game.emitters = k.emitters;
+    game.bullets = k.bullets;
+    game.bullets.next_id = k.next_id;
+    for (uint64_t t = key + 1; t <= tick; t++) {
+        apply_delta(frame(t), game);
+    }
+    // the frames after tick are dropped, they are overwritten as the ticks are played again
+    newest_tick = tick;
+    remember(game);
+    return true;
+}
+
+void rollback_c::remember(const world_c& game)
+{
+    last_players = game.players;
+    last_emitters = game.emitters;
+    last_bullets = game.bullets;
+}
+
+void rollback_c::make_delta(frame_c& f, const world_c& game)
+{
+    delta_entities(game.players, last_players, f.player_count, f.player_index, f.players);
+    delta_entities(game.emitters, last_emitters, f.emitter_count, f.emitter_index, f.emitters);
+
+    auto& current = game.bullets;
+    auto& last = last_bullets;
+    f.bullets.clear();
+    f.removed.clear();
+    f.changed.clear();
+    f.changed_fields.clear();
+    f.vectors.clear();
+    f.scalars.clear();
+    f.types.clear();
+    f.bytes.clear();
+
+    // both pools were pushed after a compaction, so they are sorted by group and then id
+    // (a bullet keeps its group) and one pass matches them
+    auto before = [](const bullet_pool_c& a, size_t i, const bullet_pool_c& b, size_t j) {
+        return a.group(i) < b.group(j) || (a.group(i) == b.group(j) && a.id[i] < b.id[j]);
+    };
+    size_t j = 0;
+    for (size_t i = 0; i < last.size(); i++) {
+        for (; j < current.size() && before(current, j, last, i); j++) append(f.bullets, current, j);
+        if (j >= current.size() || current.id[j] != last.id[i]) {
+            f.removed.push_back(i);
+            continue;
+        }
+        uint16_t fields = 0;
+        if (!same(current.position[j], last.position[i])) {
+            fields |= FIELD_POSITION;
+            f.vectors.push_back(current.position[j]);
+        }
+        if (!same(current.previous_position[j], last.position[i])) {
+            fields |= FIELD_PREVIOUS_POSITION;
+            f.vectors.push_back(current.previous_position[j]);
+        }
+        if (!same(current.velocity[j], last.velocity[i])) {
+            fields |= FIELD_VELOCITY;
+            f.vectors.push_back(current.velocity[j]);
+        }
+        if (!same(current.acceleration[j], last.acceleration[i])) {
+            fields |= FIELD_ACCELERATION;
+            f.vectors.push_back(current.acceleration[j]);
+        }
+        if (!same(current.friction[j], last.friction[i])) {
+            fields |= FIELD_FRICTION;
+            f.scalars.push_back(current.friction[j]);
+        }
+        if (!same(current.time[j], last.time[i])) {
+            fields |= FIELD_TIME;
+            f.scalars.push_back(current.time[j]);
+        }
+        if (current.type[j] != last.type[i]) {
+            fields |= FIELD_TYPE;
+            f.types.push_back(current.type[j]);
+        }
+        if (current.program[j] != last.program[i]) {
+            fields |= FIELD_PROGRAM;
+            f.bytes.push_back(current.program[j]);
+        }
+        if (current.flags[j] != last.flags[i]) {
+            fields |= FIELD_FLAGS;
+            f.bytes.push_back(current.flags[j]);
+        }
+        if (fields) {
+            f.changed.push_back(j);
+            f.changed_fields.push_back(fields);
+        }
+        j++;
+    }
+    for (; j < current.size(); j++) append(f.bullets, current, j);
+}
+
+void rollback_c::apply_delta(const frame_c& f, world_c& game)
+{
+    apply_entities(game.players, f.player_count, f.player_index, f.players);
+    apply_entities(game.emitters, f.emitter_count, f.emitter_index, f.emitters);
+
+    auto& b = game.bullets;
+    // unless stored, the previous position is the position of the tick before
+    b.previous_position = b.position;
+    // the spawned bullets go to the end, the compaction sorts them into their groups
+    for (size_t i = 0; i < f.bullets.size(); i++) append(b, f.bullets, i);
+    if (!f.removed.empty() || !f.bullets.empty()) {
+        removed_bits.assign((b.size() + 63) / 64, 0);
+        for (auto i : f.removed) removed_bits[i / 64] |= 1ull << (i % 64);
+        b.compact([&](size_t i) { return !(removed_bits[i / 64] & (1ull << (i % 64))); });
+    }
+
+    size_t v = 0, s = 0, t = 0, y = 0;
+    for (size_t k = 0; k < f.changed.size(); k++) {
+        uint32_t j = f.changed[k];
+        uint16_t fields = f.changed_fields[k];
+        if (fields & FIELD_POSITION) b.position[j] = f.vectors[v++];
+        if (fields & FIELD_PREVIOUS_POSITION) b.previous_position[j] = f.vectors[v++];
+        if (fields & FIELD_VELOCITY) b.velocity[j] = f.vectors[v++];
+        if (fields & FIELD_ACCELERATION) b.acceleration[j] = f.vectors[v++];
+        if (fields & FIELD_FRICTION) b.friction[j] = f.scalars[s++];
+        if (fields & FIELD_TIME) b.time[j] = f.scalars[s++];
+        if (fields & FIELD_TYPE) b.type[j] = f.types[t++];
+        if (fields & FIELD_PROGRAM) b.program[j] = f.bytes[y++];
+        if (fields & FIELD_FLAGS) b.flags[j] = f.bytes[y++];
+    }
+    b.next_id = f.next_id;
+}
+
+size_t rollback_c::frame_c::memory() const
+{
+    return player_index.capacity() * sizeof(uint32_t) + players.capacity() * sizeof(player_c) +
+           emitter_index.capacity() * sizeof(uint32_t) + emitters.capacity() * sizeof(emitter_c) +
+           bullets.position.capacity() * (4 * sizeof(vec2_t) + 2 * sizeof(real_t) + sizeof(uint16_t) + 2 + sizeof(uint32_t)) +
+           removed.capacity() * sizeof(uint32_t) + changed.capacity() * sizeof(uint32_t) +
+           changed_fields.capacity() * sizeof(uint16_t) + vectors.capacity() * sizeof(vec2_t) +
+           scalars.capacity() * sizeof(real_t) + types.capacity() * sizeof(uint16_t) + bytes.capacity();
+}
+
+size_t rollback_c::memory() const
+{
+    size_t m = 0;
+    for (auto& f : frames) m += f.memory();
+    return m;
+}
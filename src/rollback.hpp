@@ -0,0 +1,103 @@
+#ifndef ___ROLLBACK_FOR_BULLETHELL_HPP__
+#define ___ROLLBACK_FOR_BULLETHELL_HPP__
+
+#include "world.hpp"
+#include <cstdint>
+#include <vector>
+
+/**
+ * the last few hundred ticks of the world, to rewind the simulation (rollback
+ * input correction, debugging).
+ *
+ * Every keyframe_interval-th tick is a keyframe with a full copy of the players,
+ * emitters and bullets; the ticks in between only store what changed since the
+ * tick before. Frames live in a ring and their buffers are reused, so the memory
+ * does not grow with the length of the session. Restoring a tick applies at most
+ * keyframe_interval - 1 deltas to its keyframe.
+ *
+ * Obstacles are level data and are not part of the frames.
+ * */
+class rollback_c
+{
+public:
+    /// ticks kept is rounded up to a multiple of keyframe_interval
+    rollback_c(unsigned ticks = 256, unsigned keyframe_interval = 32);
+
+    /// stores the state after tick, which follows the newest stored tick (else the ring starts over)
+    void push(const world_c& game, uint64_t tick);
+
+    /// puts the world back to the state after tick, the ticks after it are dropped
+    bool restore(world_c& game, uint64_t tick);
+
+    bool empty() const { return !started; }
+    uint64_t newest() const { return newest_tick; }
+    /// the oldest tick that can be restored
+    uint64_t oldest() const;
+
+    /// bytes held by the frames, for tuning the interval
+    size_t memory() const;
+
+private:
+    /// bullet fields which changed, bit per field
+    enum bullet_field_e : uint16_t {
+        FIELD_POSITION = 1 << 0,
+        FIELD_PREVIOUS_POSITION = 1 << 1, // set when it is not the position of the tick before
+        FIELD_VELOCITY = 1 << 2,
+        FIELD_ACCELERATION = 1 << 3,
+        FIELD_FRICTION = 1 << 4,
+        FIELD_TIME = 1 << 5,
+        FIELD_TYPE = 1 << 6,
+        FIELD_PROGRAM = 1 << 7,
+        FIELD_FLAGS = 1 << 8,
+    };
+
+    class frame_c
+    {
+    public:
+        uint64_t tick;
+        bool keyframe;
+        uint32_t next_id;
+
+        // keyframe: all of them, delta: the changed ones at the indices
+        uint32_t player_count;
+        std::vector<uint32_t> player_index;
+        std::vector<player_c> players;
+        uint32_t emitter_count;
+        std::vector<uint32_t> emitter_index;
+        std::vector<emitter_c> emitters;
+
+        // keyframe: the whole pool, delta: the bullets spawned during the tick
+        bullet_pool_c bullets;
+        // delta only - indices in the pool of the tick before
+        std::vector<uint32_t> removed;
+        // delta only - indices in the pool of the tick, with the changed fields; values are in field order
+        std::vector<uint32_t> changed;
+        std::vector<uint16_t> changed_fields;
+        std::vector<vec2_t> vectors;
+        std::vector<real_t> scalars;
+        std::vector<uint16_t> types;
+        std::vector<uint8_t> bytes;
+
+        size_t memory() const;
+    };
+
+    unsigned keyframe_interval;
+    std::vector<frame_c> frames;
+    uint64_t first_tick = 0; // of the sequence, keyframes are every keyframe_interval from it
+    uint64_t lowest_tick = 0; // the oldest tick whose frame was not overwritten, only push raises it
+    uint64_t newest_tick = 0;
+    bool started = false;
+
+    // the state of the newest tick, deltas are made against it
+    std::vector<player_c> last_players;
+    std::vector<emitter_c> last_emitters;
+    bullet_pool_c last_bullets;
+    std::vector<uint64_t> removed_bits;
+
+    frame_c& frame(uint64_t tick) { return frames[(tick - first_tick) % frames.size()]; }
+    void make_delta(frame_c& f, const world_c& game);
+    void apply_delta(const frame_c& f, world_c& game);
+    void remember(const world_c& game);
+};
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef ___SECTIONED_FILE_FOR_BULLETHELL_HPP__
+#define ___SECTIONED_FILE_FOR_BULLETHELL_HPP__
+
+#include "mapped_file.hpp"
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * files laid out as a header followed by sections (snapshots, asset packs). The
+ * header type H has an array sections of {offset, count, record_size, reserved},
+ * and each section is one array of fixed size records starting at a 64 byte
+ * aligned offset, so it can be used straight from the mapped file.
+ * */
+
+/// collects the sections, then writes them in one go - the header starts zeroed
+template <typename H>
+class sectioned_writer_c
+{
+public:
+    H header;
+    std::vector<std::pair<const void*, size_t>> parts;
+    uint64_t offset = sizeof(H);
+
+    sectioned_writer_c() { std::memset(&header, 0, sizeof(header)); }
+
+    template <typename T>
+    void section(uint32_t s, const T* records, size_t count)
+    {
+        static const char zeros[64] = {};
+        size_t pad = (64 - offset % 64) % 64;
+        parts.push_back({zeros, pad});
+        offset += pad;
+        header.sections[s] = {offset, count, sizeof(T), 0};
+        parts.push_back({records, count * sizeof(T)});
+        offset += count * sizeof(T);
+    }
+
+    /// false if the file can not be written
+    bool write(const std::string& file_name) const
+    {
+        std::ofstream file(file_name, std::ios::binary);
+        if (!file) return false;
+        file.write((const char*)&header, sizeof(header));
+        for (auto& [p, size] : parts) file.write((const char*)p, size);
+        return (bool)file;
+    }
+};
+
+/// records of section s, nullptr if the section does not fit the file or has other records
+template <typename T, typename H>
+const T* section_records(const mapped_file_c& m, const H& h, uint32_t s)
+{
+    auto& section = h.sections[s];
+    if (section.record_size != sizeof(T)) return nullptr;
+    if (section.offset % alignof(T)) return nullptr;
+    if (section.offset > m.size || section.count > (m.size - section.offset) / sizeof(T)) return nullptr;
+    return (const T*)(m.data + section.offset);
+}
+
+/// zero terminated names of a section, false if the last one is not terminated
+inline bool section_names(const char* names, size_t size, std::vector<std::string>& result)
+{
+    if (size && names[size - 1]) return false;
+    for (size_t at = 0; at < size; at += std::strlen(names + at) + 1) result.push_back(names + at);
+    return true;
+}
+
+#endif
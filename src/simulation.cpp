@@ -0,0 +1,424 @@
+#include "simulation.hpp"
+#include "collision.hpp"
+#include "profiler.hpp"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/**
+ * same textured tiles merged into rectangles - every rectangle takes the widest run
+ * of tiles from its top left tile, then grows down while the whole run continues.
+ * tiles holds the texture of every tile plus one, 0 is empty; merged tiles become 0.
+ * */
+static void merge_tiles(world_c& game, std::vector<uint32_t>& tiles, int width, int height, vec2_t origin)
+{
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            uint32_t t = tiles[y * width + x];
+            if (!t) continue;
+            int w = 1;
+            while ((x + w < width) && (tiles[y * width + x + w] == t)) w++;
+            int h = 1;
+            for (; y + h < height; h++) {
+                auto row = tiles.begin() + (y + h) * width + x;
+                if (std::count(row, row + w, t) != w) break;
+            }
+            for (int j = 0; j < h; j++) {
+                std::fill(tiles.begin() + (y + j) * width + x, tiles.begin() + (y + j) * width + x + w, 0);
+            }
+            obstacle_c o;
+            o.position = {origin[0] + x, origin[1] + y};
+            o.size = vec2_t(w, h);
+            o.texture = t - 1;
+            game.obstacles.push_back(o);
+        }
+    }
+}
+
+bool load_level(world_c& game, const std::string& file_name)
+{
+    std::ifstream file(file_name);
+    if (!file) return false;
+    std::map<char, uint16_t> textures;
+    vec2_t origin = {0, 0};
+    std::vector<std::string> map;
+    std::vector<player_c> players;
+    std::vector<emitter_c> emitters;
+    bool in_map = false;
+    for (std::string line; std::getline(file, line);) {
+        if (in_map) {
+            map.push_back(line);
+            continue;
+        }
+        std::istringstream ss(line);
+        std::string command;
+        ss >> command;
+        if (command.empty() || command[0] == '#') continue;
+        if (command == "tile") {
+            std::string c, sprite;
+            ss >> c >> sprite;
+            if (c.size() != 1 || sprite.empty()) return false;
+            textures[c[0]] = game.sprites.id(sprite);
+        }
+        else if (command == "origin") {
+            ss >> origin[0] >> origin[1];
+        }
+        else if (command == "player") {
+            vec2_t p;
+            ss >> p[0] >> p[1];
+            players.push_back(player_c(p));
+        }
+        else if (command == "emitter") {
+            emitter_c e;
+            std::string pattern;
+            ss >> e.position[0] >> e.position[1] >> e.emit_delay >> pattern;
+            int p = pattern_library_c::find(game.patterns.emitters, pattern);
+            if (p < 0) return false;
+            e.pattern = p;
+            e.velocity = {0, 0};
+            e.acceleration = {0, 0};
+            e.friction = 0;
+            e.emit_to_emit = 0;
+            emitters.push_back(e);
+        }
+        else if (command == "map") {
+            in_map = true;
+            continue;
+        }
+        else {
+            return false;
+        }
+        if (!ss) return false;
+    }
+
+    int width = 0;
+    for (auto& row : map) width = std::max(width, (int)row.size());
+    int height = map.size();
+    std::vector<uint32_t> tiles(width * height, 0);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < (int)map[y].size(); x++) {
+            auto t = textures.find(map[y][x]);
+            if (t != textures.end()) tiles[y * width + x] = t->second + 1;
+        }
+    }
+
+    game.players.insert(game.players.end(), players.begin(), players.end());
+    game.emitters.insert(game.emitters.end(), emitters.begin(), emitters.end());
+    merge_tiles(game, tiles, width, height, origin);
+    return true;
+}
+
+void initialize_world(world_c &game, const std::string& level, const std::string& patterns)
+{
+    /// BULLET PATTERNS
+    if (!load_patterns(game, patterns)) throw std::runtime_error("can not load the patterns " + patterns);
+
+    /// PLAYERS, OBSTACLES, EMITTERS
+    if (!load_level(game, level)) throw std::runtime_error("can not load the level " + level);
+    game.obstacles_changed();
+    game.bullets.reserve(4096);
+
+    /// physics details
+    game.dt = std::chrono::milliseconds(15);
+}
+
+void apply_intents(world_c& game, const std::vector<uint32_t>& intents)
+{
+    for (unsigned i = 0; i < game.players.size() && i < intents.size(); i++) {
+        auto& player = game.players[i];
+        player.intentions = intents[i];
+        if (player.intentions & INTENT_WARP_TOP) player.position = {4, 10};
+        if (player.intentions & INTENT_WARP_SPAWN) player.position = {4, 30};
+    }
+}
+
+/**
+ * bullets (found in game.bullet_hash) which hit player i, in the order they hit.
+ * Bullets marked in taken were already taken by other players and are skipped.
+ * */
+static void damage_player(world_c& game, unsigned i, const uint64_t* taken, std::vector<uint32_t>& found, std::vector<uint32_t>& hits)
+{
+    const real_t hit_distance2 = 1.3 * 1.3;
+    auto& bullets = game.bullets;
+    auto& player = game.players[i];
+    hits.clear();
+    game.bullet_hash.query(player.position, found);
+    profiler.count(COUNTER_DAMAGE_TESTS, found.size());
+    for (size_t k = 0; k < found.size();) {
+        uint32_t j = found[k++];
+        if (taken && (taken[j / 64] & (1ull << (j % 64)))) continue;
+        auto d = player.position - bullets.position[j];
+        if (d[0] * d[0] + d[1] * d[1] < hit_distance2) {
+            hits.push_back(j);
+            player.hits_taken++;
+            player.health -= 10;
+            auto& program = game.patterns.bullets[bullets.program[j]];
+            if (program.knockback) {
+                player.velocity[0] = program.knockback_velocity;
+            }
+            if (player.health <= 0) {
+                player.position = {4, 30};
+                player.health = 100;
+                // the player moved, the remaining bullets are looked up around the new position
+                game.bullet_hash.query(player.position, found);
+                profiler.count(COUNTER_DAMAGE_TESTS, found.size());
+                found.erase(found.begin(), std::upper_bound(found.begin(), found.end(), j));
+                k = 0;
+            }
+        }
+    }
+}
+
+void process_events(world_c& game)
+{
+    profile_scope_c profile(PROFILE_EVENTS);
+    real_t dt_f = game.dt.count() / 1000.0;
+    auto& scratch = game.scratch;
+    scratch.arena.reset();
+    /// apply safe place and hit points
+//     for (unsigned i = 0; i < game.players.size(); i++) {
+//         auto& p = game.players[i];
+//         if ((p.is_safe_place())) {
+//             p.health += dt_f * 10.0;
+//             if (p.health > 100.0) p.health = 100;
+//         } else {
+//             p.points += dt_f * 10.0;
+//         }
+//     }
+
+    auto shooting_start = profiler_c::clock::now();
+    // EMITTERS
+    for (auto& e : game.emitters) {
+        e.emit_to_emit -= dt_f;
+        if (e.emit_to_emit <= 0.0) {
+            e.emit_to_emit = e.emit_delay;
+            fire_pattern(game, game.patterns.emitters[e.pattern], e.position, 0, e.velocity, e.angle);
+        }
+    }
+
+    // PLAYER SHOOTING
+    if (game.players[0].intentions & INTENT_SHOOT) {
+        auto& player = game.players[0];
+        double angle = player.gun_angle + 90;
+        if (player.last_move_left) {
+            angle = -angle;
+        }
+        // the gun angle is measured from straight down
+        real_t rad = M_PI / 2 - angle * M_PI / 180;
+        real_t spin = 0;
+        fire_pattern(game, game.patterns.emitters[game.gun_pattern], vec2_t(player.position[0], player.position[1] - 0.2), rad, player.velocity, spin);
+    }
+    profiler.add(PROFILE_SHOOTING, shooting_start, profiler_c::clock::now());
+
+    // BULLETS WHICH DAMAGE PLAYER
+    profile_scope_c profile_damage(PROFILE_DAMAGE);
+    auto& bullets = game.bullets;
+    game.bullet_hash.build(bullets.position, bullets.flags, BULLET_DAMAGES_PLAYER);
+    size_t hit_words = (bullets.size() + 63) / 64;
+    uint64_t* hit = scratch.arena.allocate<uint64_t>(hit_words);
+    std::fill(hit, hit + hit_words, 0);
+    bool any_hit = false;
+    int chunks = tp::chunk_count(game.players.size(), 16);
+    scratch.found.resize(std::max<size_t>(scratch.found.size(), chunks));
+    if (chunks > 1) {
+        // every player on its own thread, as if no other player took any bullet
+        player_c* saved = scratch.arena.allocate<player_c>(game.players.size());
+        std::copy(game.players.begin(), game.players.end(), saved);
+        scratch.hits.resize(std::max(scratch.hits.size(), game.players.size()));
+#pragma omp parallel for schedule(static, 1) num_threads(chunks)
+        for (int c = 0; c < chunks; c++) {
+            for (size_t i = tp::chunk_begin(game.players.size(), c, chunks); i < tp::chunk_begin(game.players.size(), c + 1, chunks); i++) {
+                damage_player(game, i, nullptr, scratch.found[c], scratch.hits[i]);
+            }
+        }
+        // that is what a single thread does, unless two players hit the same bullet
+        bool conflict = false;
+        for (size_t i = 0; i < game.players.size(); i++) {
+            for (auto j : scratch.hits[i]) {
+                if (hit[j / 64] & (1ull << (j % 64))) conflict = true;
+                hit[j / 64] |= 1ull << (j % 64);
+            }
+            any_hit = any_hit || !scratch.hits[i].empty();
+        }
+        if (conflict) {
+            std::copy(saved, saved + game.players.size(), game.players.begin());
+            std::fill(hit, hit + hit_words, 0);
+            chunks = 1;
+        }
+    }
+    if (chunks == 1) {
+        scratch.hits.resize(std::max<size_t>(scratch.hits.size(), 1));
+        auto& found = scratch.found[0];
+        auto& hits = scratch.hits[0];
+        for (unsigned i = 0; i < game.players.size(); i++) {
+//         if (!game.players[i].is_safe_place())
+            damage_player(game, i, hit, found, hits);
+            for (auto j : hits) hit[j / 64] |= 1ull << (j % 64);
+            any_hit = any_hit || !hits.empty();
+        }
+    }
+    if (any_hit) {
+        bullets.compact([&](size_t j) { return !(hit[j / 64] & (1ull << (j % 64))); });
+    }
+}
+
+void process_physics(world_c& game)
+{
+    profile_scope_c profile(PROFILE_PHYSICS);
+    real_t dt_f = game.dt.count() / 1000.0;
+    auto& scratch = game.scratch;
+    scratch.arena.reset();
+
+    // where the players were before they moved - only the positions are needed
+    auto* old_position = scratch.arena.allocate<vec2_t>(game.players.size());
+    for (size_t i = 0; i < game.players.size(); i++) old_position[i] = game.players[i].position;
+    bool parallel_players = game.players.size() >= 64;
+    // update moves
+#pragma omp parallel for schedule(static) if (parallel_players)
+    for (size_t i = 0; i < game.players.size(); i++) {
+        game.players[i].update(dt_f);
+    }
+
+
+    // update bullets
+    auto& bullets = game.bullets;
+    auto& found_in_thread = scratch.found;
+    found_in_thread.resize(std::max<size_t>(found_in_thread.size(), tp::max_threads()));
+    auto stage_start = profiler_c::clock::now();
+    bullets.update(dt_f, game.patterns);
+    auto stage_end = profiler_c::clock::now();
+    profiler.add(PROFILE_BULLET_UPDATE, stage_start, stage_end);
+    stage_start = stage_end;
+    bullets.compact([&](size_t i) {
+        auto& found = found_in_thread[tp::thread_index()];
+        auto& position = bullets.position[i];
+        auto& velocity = bullets.velocity[i];
+        const auto& old_position = bullets.previous_position[i];
+
+        if (bullets.flags[i] & BULLET_EXPIRED) return false;
+
+        bool ok = true;
+        if (bullets.flags[i] & BULLET_BLOCKED_BY_OBSTACLES) {
+            real_t ss = 0.4;
+            game.obstacle_grid.query(std::min(position[0], old_position[0]) - ss, std::min(position[1], old_position[1]) - ss,
+                                     std::max(position[0], old_position[0]) + ss, std::max(position[1], old_position[1]) + ss, found);
+            profiler.count(COUNTER_OBSTACLE_TESTS, found.size());
+            // swept along the whole move, so fast bullets do not pass through obstacles
+            position = slide_box(game.obstacles, found, old_position, position - old_position, {ss, ss}, [&](const contact_c& contact) {
+                if (bullets.flags[i] & BULLET_DESTROYED_ON_CONTACT) {
+                    ok = false;
+                }
+                for (int a = 0; a < 2; a++) {
+                    if (velocity[a] * contact.normal[a] < 0) velocity[a] = 0;
+                }
+                if (contact.normal[1] != 0) {
+                    velocity[0] *= 0.97;
+                }
+            });
+        }
+
+        // after the obstacles, a bullet stopped by one is not lost
+        if (!((position[0] > -10.0) && (position[0] < 74) && (position[0] > -1000.0) && (position[1] < 74))) {
+            return false;
+        }
+        return ok;
+    });
+    stage_end = profiler_c::clock::now();
+    profiler.add(PROFILE_BULLET_COLLISION, stage_start, stage_end);
+    stage_start = stage_end;
+
+    // COLLISIONS BETWEEN PLAYERS
+    for (unsigned i = 0; i < game.players.size(); i++) {
+        for (unsigned j = i + 1; j < game.players.size(); j++) {
+            if (length(game.players[i].position - game.players[j].position) < 1.0) {
+                game.players[i].position = old_position[i];
+                game.players[j].position = old_position[j];
+                auto vec = game.players[i].position - game.players[j].position;
+                vec = vec * (1 / length(vec));
+                game.players[i].velocity = vec; //old_players[i].position;
+                game.players[j].velocity = vec * -1;
+            }
+        }
+    }
+
+    // PLAYER COLLISIONS WITH OBSTACLES
+    // every player on its own, in parallel when there are many of them
+#pragma omp parallel for schedule(static) if (parallel_players)
+    for (size_t i = 0; i < game.players.size(); i++) {
+        auto& found = found_in_thread[tp::thread_index()];
+        auto &p = game.players[i];
+        real_t halfheight = 0;
+        if (p.crouching)
+            halfheight = 0.7;
+        else
+            halfheight = 1.2;
+        auto &old_p = old_position[i];
+        game.obstacle_grid.query(std::min(p.position[0], old_p[0]) - 0.7, std::min(p.position[1], old_p[1]) - halfheight,
+                                 std::max(p.position[0], old_p[0]) + 0.7, std::max(p.position[1], old_p[1]) + halfheight, found);
+        profiler.count(COUNTER_OBSTACLE_TESTS, found.size());
+        p.position = slide_box(game.obstacles, found, old_p, p.position - old_p, {0.7, halfheight}, [&](const contact_c& contact) {
+            for (int a = 0; a < 2; a++) {
+                if (p.velocity[a] * contact.normal[a] < 0) p.velocity[a] = 0;
+            }
+            // landed on top of the obstacle
+            if (contact.normal[1] < 0) {
+                p.on_ground = true;
+            }
+        });
+    }
+    profiler.add(PROFILE_PLAYER_COLLISION, stage_start, profiler_c::clock::now());
+
+    profiler.count(COUNTER_BULLETS, bullets.size());
+    profiler.count(COUNTER_PLAYERS, game.players.size());
+    profiler.count(COUNTER_EMITTERS, game.emitters.size());
+    profiler.end_tick();
+}
+
+/// FNV-1a over the raw bytes of a range of values
+template <typename T>
+static void hash_values(uint64_t& h, const T* values, size_t n)
+{
+    auto bytes = reinterpret_cast<const uint8_t*>(values);
+    for (size_t i = 0; i < n * sizeof(T); i++) {
+        h = (h ^ bytes[i]) * 0x100000001b3ull;
+    }
+}
+
+uint64_t state_hash(const world_c& game)
+{
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (auto& p : game.players) {
+        hash_values(h, &p.position, 1);
+        hash_values(h, &p.velocity, 1);
+        hash_values(h, &p.acceleration, 1);
+        hash_values(h, &p.health, 1);
+        hash_values(h, &p.jump_time_left, 1);
+        hash_values(h, &p.gun_angle, 1);
+        uint8_t flags = p.jump_available | (p.crouching << 1) | (p.last_move_left << 2) | (p.on_ground << 3);
+        hash_values(h, &flags, 1);
+    }
+    for (auto& e : game.emitters) {
+        hash_values(h, &e.position, 1);
+        hash_values(h, &e.emit_to_emit, 1);
+        hash_values(h, &e.angle, 1);
+    }
+    // sprite ids (bullet type) depend on what the renderer loaded, they do not take part
+    auto& b = game.bullets;
+    size_t n = b.size();
+    hash_values(h, &n, 1);
+    hash_values(h, b.position.data(), n);
+    hash_values(h, b.velocity.data(), n);
+    hash_values(h, b.acceleration.data(), n);
+    hash_values(h, b.time.data(), n);
+    hash_values(h, b.program.data(), n);
+    hash_values(h, b.flags.data(), n);
+    return h;
+}
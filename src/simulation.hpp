@@ -0,0 +1,40 @@
+#ifndef ___SIMULATION_FOR_BULLETHELL_HPP__
+#define ___SIMULATION_FOR_BULLETHELL_HPP__
+
+#include "world.hpp"
+#include <string>
+
+/**
+ * adds the obstacles, players and emitters of a level file (see data/level1.txt),
+ * false if it can not be read. The emitter patterns have to be loaded already.
+ * */
+bool load_level(world_c& game, const std::string& file_name);
+
+/**
+ * loads the bullet patterns and the level and sets the physics details, throws
+ * std::runtime_error if either can not be loaded
+ * */
+void initialize_world(world_c& game, const std::string& level = "data/level1.txt", const std::string& patterns = "data/patterns.txt");
+
+/**
+ * sets the intents of the players for the next tick, one intent_e mask per player
+ * */
+void apply_intents(world_c& game, const std::vector<uint32_t>& intents);
+
+/**
+ * emitters, player shooting and bullets which damage players
+ * */
+void process_events(world_c& game);
+
+/**
+ * moves players and bullets and resolves their collisions
+ * */
+void process_physics(world_c& game);
+
+/**
+ * FNV-1a hash of everything the simulation depends on, to check that two runs
+ * (a recording and its replay) stay identical
+ * */
+uint64_t state_hash(const world_c& game);
+
+#endif
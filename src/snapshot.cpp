@@ -0,0 +1,232 @@
+#include "snapshot.hpp"
+#include "sectioned_file.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+static_assert(std::is_trivially_copyable<snapshot_header_c>::value);
+static_assert(std::is_trivially_copyable<snapshot_player_c>::value);
+static_assert(std::is_trivially_copyable<snapshot_emitter_c>::value);
+static_assert(std::is_trivially_copyable<snapshot_obstacle_c>::value);
+
+static const char snapshot_magic[8] = "GOTYSNP";
+
+bool save_snapshot(const world_c& game, const std::string& file_name)
+{
+    sectioned_writer_c<snapshot_header_c> w;
+    std::memcpy(w.header.magic, snapshot_magic, sizeof(snapshot_magic));
+    w.header.version = snapshot_version;
+    w.header.section_count = SNAPSHOT_SECTION_COUNT;
+    w.header.dt_ms = game.dt.count();
+    w.header.bullet_next_id = game.bullets.next_id;
+    w.header.precision = precision;
+
+    std::string names, bullet_programs, emitter_programs;
+    for (auto& n : game.sprites.names) names.append(n.c_str(), n.size() + 1);
+    for (auto& p : game.patterns.bullets) bullet_programs.append(p.name.c_str(), p.name.size() + 1);
+    for (auto& p : game.patterns.emitters) emitter_programs.append(p.name.c_str(), p.name.size() + 1);
+    w.section(SNAPSHOT_NAMES, names.data(), names.size());
+    w.section(SNAPSHOT_BULLET_PROGRAM_NAMES, bullet_programs.data(), bullet_programs.size());
+    w.section(SNAPSHOT_EMITTER_PROGRAM_NAMES, emitter_programs.data(), emitter_programs.size());
+
+    std::vector<snapshot_player_c> players(game.players.size());
+    for (unsigned i = 0; i < players.size(); i++) {
+        auto& p = game.players[i];
+        players[i] = {p.position, p.velocity, p.acceleration, p.friction, p.health, p.points, p.max_hspeed,
+            p.jump_time, p.jump_time_left, p.gun_angle, p.intentions,
+            p.jump_available, p.crouching, p.last_move_left, p.on_ground, p.hits_taken};
+    }
+    w.section(SNAPSHOT_PLAYERS, players.data(), players.size());
+
+    std::vector<snapshot_emitter_c> emitters(game.emitters.size());
+    for (unsigned i = 0; i < emitters.size(); i++) {
+        auto& e = game.emitters[i];
+        emitters[i] = {e.position, e.velocity, e.acceleration, e.friction, e.emit_to_emit, e.emit_delay, e.angle, e.pattern, {0, 0, 0}};
+    }
+    w.section(SNAPSHOT_EMITTERS, emitters.data(), emitters.size());
+
+    std::vector<snapshot_obstacle_c> obstacles(game.obstacles.size());
+    for (unsigned i = 0; i < obstacles.size(); i++) {
+        auto& o = game.obstacles[i];
+        obstacles[i] = {o.position, o.size, o.texture, {0, 0, 0}};
+    }
+    w.section(SNAPSHOT_OBSTACLES, obstacles.data(), obstacles.size());
+
+    auto& b = game.bullets;
+    size_t n = b.size();
+    w.section(SNAPSHOT_BULLET_POSITION, b.position.data(), n);
+    w.section(SNAPSHOT_BULLET_PREVIOUS_POSITION, b.previous_position.data(), n);
+    w.section(SNAPSHOT_BULLET_VELOCITY, b.velocity.data(), n);
+    w.section(SNAPSHOT_BULLET_ACCELERATION, b.acceleration.data(), n);
+    w.section(SNAPSHOT_BULLET_FRICTION, b.friction.data(), n);
+    w.section(SNAPSHOT_BULLET_TIME, b.time.data(), n);
+    w.section(SNAPSHOT_BULLET_TYPE, b.type.data(), n);
+    w.section(SNAPSHOT_BULLET_PROGRAM, b.program.data(), n);
+    w.section(SNAPSHOT_BULLET_FLAGS, b.flags.data(), n);
+    w.section(SNAPSHOT_BULLET_ID, b.id.data(), n);
+
+    return w.write(file_name);
+}
+
+/// for every program name of the file, its index in the loaded programs - false if one is missing
+static bool program_ids(const std::vector<std::string>& names, const std::vector<pattern_program_c>& programs, std::vector<uint16_t>& ids)
+{
+    for (auto& name : names) {
+        int p = pattern_library_c::find(programs, name);
+        if (p < 0) return false;
+        ids.push_back(p);
+    }
+    return true;
+}
+
+template <typename T>
+static void assign(std::vector<T>& v, const T* records, size_t n)
+{
+    v.resize(n);
+    if (n) std::memcpy(v.data(), records, n * sizeof(T));
+}
+
+bool load_snapshot(world_c& game, const std::string& file_name)
+{
+    mapped_file_c m(file_name);
+    if (!m.data || m.size < sizeof(snapshot_header_c)) return false;
+    snapshot_header_c h;
+    std::memcpy(&h, m.data, sizeof(h));
+    if (std::memcmp(h.magic, snapshot_magic, sizeof(snapshot_magic)) != 0) return false;
+    if (h.version != snapshot_version || h.section_count != SNAPSHOT_SECTION_COUNT) return false;
+    if (h.precision != precision) return false;
+
+    auto names = section_records<char>(m, h, SNAPSHOT_NAMES);
+    auto players = section_records<snapshot_player_c>(m, h, SNAPSHOT_PLAYERS);
+    auto emitters = section_records<snapshot_emitter_c>(m, h, SNAPSHOT_EMITTERS);
+    auto obstacles = section_records<snapshot_obstacle_c>(m, h, SNAPSHOT_OBSTACLES);
+    auto position = section_records<vec2_t>(m, h, SNAPSHOT_BULLET_POSITION);
+    auto previous_position = section_records<vec2_t>(m, h, SNAPSHOT_BULLET_PREVIOUS_POSITION);
+    auto velocity = section_records<vec2_t>(m, h, SNAPSHOT_BULLET_VELOCITY);
+    auto acceleration = section_records<vec2_t>(m, h, SNAPSHOT_BULLET_ACCELERATION);
+    auto friction = section_records<real_t>(m, h, SNAPSHOT_BULLET_FRICTION);
+    auto time = section_records<real_t>(m, h, SNAPSHOT_BULLET_TIME);
+    auto type = section_records<uint16_t>(m, h, SNAPSHOT_BULLET_TYPE);
+    auto program = section_records<uint8_t>(m, h, SNAPSHOT_BULLET_PROGRAM);
+    auto flags = section_records<uint8_t>(m, h, SNAPSHOT_BULLET_FLAGS);
+    auto id = section_records<uint32_t>(m, h, SNAPSHOT_BULLET_ID);
+    if (!names || !players || !emitters || !obstacles || !position || !previous_position || !velocity ||
+        !acceleration || !friction || !time || !type || !program || !flags || !id) return false;
+    size_t n = h.sections[SNAPSHOT_BULLET_POSITION].count;
+    for (unsigned s = SNAPSHOT_BULLET_POSITION; s <= SNAPSHOT_BULLET_ID; s++) {
+        if (h.sections[s].count != n) return false;
+    }
+
+    // programs of the file to the programs loaded in this world
+    std::vector<std::string> bullet_program_names, emitter_program_names;
+    std::vector<uint16_t> bullet_programs, emitter_programs;
+    auto bullet_program_section = section_records<char>(m, h, SNAPSHOT_BULLET_PROGRAM_NAMES);
+    auto emitter_program_section = section_records<char>(m, h, SNAPSHOT_EMITTER_PROGRAM_NAMES);
+    if (!bullet_program_section || !emitter_program_section) return false;
+    if (!section_names(bullet_program_section, h.sections[SNAPSHOT_BULLET_PROGRAM_NAMES].count, bullet_program_names)) return false;
+    if (!section_names(emitter_program_section, h.sections[SNAPSHOT_EMITTER_PROGRAM_NAMES].count, emitter_program_names)) return false;
+    if (!program_ids(bullet_program_names, game.patterns.bullets, bullet_programs)) return false;
+    if (!program_ids(emitter_program_names, game.patterns.emitters, emitter_programs)) return false;
+    for (size_t i = 0; i < h.sections[SNAPSHOT_EMITTERS].count; i++) {
+        if (emitters[i].pattern >= emitter_programs.size()) return false;
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (program[i] >= bullet_programs.size()) return false;
+    }
+
+    // sprite ids of the file to the ids of this world - names the world does not have yet
+    // get the ids they will have once interned, which waits until the whole file is checked
+    std::vector<std::string> sprite_names, new_sprite_names;
+    std::vector<uint16_t> sprite_ids;
+    if (!section_names(names, h.sections[SNAPSHOT_NAMES].count, sprite_names)) return false;
+    for (auto& name : sprite_names) {
+        int found = game.sprites.find(name);
+        size_t id = found;
+        if (found < 0) {
+            size_t k = std::find(new_sprite_names.begin(), new_sprite_names.end(), name) - new_sprite_names.begin();
+            if (k == new_sprite_names.size()) new_sprite_names.push_back(name);
+            id = game.sprites.size() + k;
+        }
+        if (id > UINT16_MAX) return false;
+        sprite_ids.push_back(id);
+    }
+    for (size_t i = 0; i < h.sections[SNAPSHOT_OBSTACLES].count; i++) {
+        if (obstacles[i].texture >= sprite_ids.size()) return false;
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (type[i] >= sprite_ids.size()) return false;
+    }
+    auto sprite = [&](uint16_t i) { return sprite_ids[i]; };
+
+    // the file is valid, only now the world is changed
+    for (auto& name : new_sprite_names) game.sprites.id(name);
+    game.dt = std::chrono::milliseconds(h.dt_ms);
+
+    game.players.resize(h.sections[SNAPSHOT_PLAYERS].count);
+    for (unsigned i = 0; i < game.players.size(); i++) {
+        auto& r = players[i];
+        auto& p = game.players[i];
+        p.position = r.position;
+        p.velocity = r.velocity;
+        p.acceleration = r.acceleration;
+        p.friction = r.friction;
+        p.health = r.health;
+        p.points = r.points;
+        p.max_hspeed = r.max_hspeed;
+        p.jump_time = r.jump_time;
+        p.jump_time_left = r.jump_time_left;
+        p.gun_angle = r.gun_angle;
+        p.intentions = r.intentions;
+        p.jump_available = r.jump_available;
+        p.crouching = r.crouching;
+        p.last_move_left = r.last_move_left;
+        p.on_ground = r.on_ground;
+        p.hits_taken = r.hits_taken;
+    }
+
+    game.emitters.resize(h.sections[SNAPSHOT_EMITTERS].count);
+    for (unsigned i = 0; i < game.emitters.size(); i++) {
+        auto& r = emitters[i];
+        auto& e = game.emitters[i];
+        e.position = r.position;
+        e.velocity = r.velocity;
+        e.acceleration = r.acceleration;
+        e.friction = r.friction;
+        e.emit_to_emit = r.emit_to_emit;
+        e.emit_delay = r.emit_delay;
+        e.angle = r.angle;
+        e.pattern = emitter_programs[r.pattern];
+    }
+
+    game.obstacles.resize(h.sections[SNAPSHOT_OBSTACLES].count);
+    for (unsigned i = 0; i < game.obstacles.size(); i++) {
+        game.obstacles[i] = {obstacles[i].position, obstacles[i].size, sprite(obstacles[i].texture)};
+    }
+    game.obstacles_changed();
+
+    auto& b = game.bullets;
+    assign(b.position, position, n);
+    assign(b.previous_position, previous_position, n);
+    assign(b.velocity, velocity, n);
+    assign(b.acceleration, acceleration, n);
+    assign(b.friction, friction, n);
+    assign(b.time, time, n);
+    assign(b.type, type, n);
+    assign(b.program, program, n);
+    assign(b.flags, flags, n);
+    assign(b.id, id, n);
+    b.next_id = h.bullet_next_id;
+    bool same_sprites = true;
+    for (unsigned i = 0; i < sprite_ids.size(); i++) same_sprites = same_sprites && (sprite_ids[i] == i);
+    if (!same_sprites) {
+        for (auto& t : b.type) t = sprite(t);
+    }
+    bool same_programs = true;
+    for (unsigned i = 0; i < bullet_programs.size(); i++) same_programs = same_programs && (bullet_programs[i] == i);
+    if (!same_programs) {
+        for (auto& p : b.program) p = bullet_programs[p];
+    }
+    return true;
+}
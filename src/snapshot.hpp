@@ -0,0 +1,117 @@
+#ifndef ___SNAPSHOT_FOR_BULLETHELL_HPP__
+#define ___SNAPSHOT_FOR_BULLETHELL_HPP__
+
+#include "world.hpp"
+#include <cstdint>
+#include <string>
+
+/**
+ * snapshots of the simulation state - a flat binary file, loaded through mmap.
+ *
+ * The file is a snapshot_header_c followed by sections, each one array of fixed
+ * size records starting at a 64 byte aligned offset. The bullet pool arrays are
+ * stored as they are in memory, so loading them is a copy. Sprites are referred
+ * to by their ids in the names section and are interned again on load, pattern
+ * programs are looked up by name in the loaded patterns.
+ * Numbers are little endian, as on every platform the game runs on.
+ * */
+enum snapshot_section_e : uint32_t {
+    SNAPSHOT_NAMES = 0, // zero terminated strings, record size 1
+    SNAPSHOT_PLAYERS,
+    SNAPSHOT_EMITTERS,
+    SNAPSHOT_OBSTACLES,
+    SNAPSHOT_BULLET_POSITION,
+    SNAPSHOT_BULLET_PREVIOUS_POSITION,
+    SNAPSHOT_BULLET_VELOCITY,
+    SNAPSHOT_BULLET_ACCELERATION,
+    SNAPSHOT_BULLET_FRICTION,
+    SNAPSHOT_BULLET_TIME,
+    SNAPSHOT_BULLET_TYPE,
+    SNAPSHOT_BULLET_PROGRAM,
+    SNAPSHOT_BULLET_FLAGS,
+    SNAPSHOT_BULLET_ID,
+    SNAPSHOT_BULLET_PROGRAM_NAMES,  // like SNAPSHOT_NAMES, for the programs of bullets
+    SNAPSHOT_EMITTER_PROGRAM_NAMES, // and of emitters
+    SNAPSHOT_SECTION_COUNT
+};
+
+class snapshot_section_c
+{
+public:
+    uint64_t offset;
+    uint64_t count;
+    uint32_t record_size; // guards against records changing without a version bump
+    uint32_t reserved;
+};
+
+class snapshot_header_c
+{
+public:
+    char magic[8]; // "GOTYSNP"
+    uint32_t version;
+    uint32_t section_count;
+    int64_t dt_ms;
+    uint32_t bullet_next_id;
+    uint32_t precision; // precision_e of the numbers, snapshots load only into the same one
+    snapshot_section_c sections[SNAPSHOT_SECTION_COUNT];
+};
+
+class snapshot_player_c
+{
+public:
+    vec2_t position;
+    vec2_t velocity;
+    vec2_t acceleration;
+    real_t friction;
+    real_t health;
+    real_t points;
+    real_t max_hspeed;
+    real_t jump_time;
+    real_t jump_time_left;
+    int32_t gun_angle;
+    uint32_t intentions;
+    uint8_t jump_available;
+    uint8_t crouching;
+    uint8_t last_move_left;
+    uint8_t on_ground;
+    uint32_t hits_taken;
+};
+
+class snapshot_emitter_c
+{
+public:
+    vec2_t position;
+    vec2_t velocity;
+    vec2_t acceleration;
+    real_t friction;
+    real_t emit_to_emit;
+    real_t emit_delay;
+    real_t angle;
+    uint16_t pattern;
+    uint16_t reserved[3];
+};
+
+class snapshot_obstacle_c
+{
+public:
+    vec2_t position;
+    vec2_t size;
+    uint16_t texture;
+    uint16_t reserved[3];
+};
+
+static const uint32_t snapshot_version = 3;
+
+/**
+ * writes the state of the world, false if the file can not be written
+ * */
+bool save_snapshot(const world_c& game, const std::string& file_name);
+
+/**
+ * replaces the state of the world with the snapshot, false (and the world
+ * untouched) if the file is not a valid snapshot of this version and precision
+ * or uses patterns which are not loaded
+ * */
+bool load_snapshot(world_c& game, const std::string& file_name);
+
+#endif
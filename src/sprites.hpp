@@ -0,0 +1,218 @@
+#ifndef __SPRITES_TP_HPP___
+#define __SPRITES_TP_HPP___
+
+#include "asset_pack.hpp"
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace tp {
+
+/**
+ * all the sprites packed into one texture. Sprites are identified by small integer
+ * handles chosen by the caller, the region of a sprite is found by indexing.
+ * */
+class sprite_atlas_c
+{
+public:
+    std::shared_ptr<SDL_Texture> texture;
+    int width = 0;
+    int height = 0;
+    std::vector<SDL_Rect> regions;
+
+    /**
+     * loads the images (handle, file) and packs them into rows. Decoding runs on
+     * a few threads, only packing and the texture upload happen on the calling
+     * (render) thread. Images which can not be loaded are skipped. Used when
+     * there is no baked pack.
+     * */
+    void build(SDL_Renderer* r, const std::vector<std::pair<int, std::string>>& files, int atlas_width = 512)
+    {
+        std::vector<std::shared_ptr<SDL_Surface>> images(files.size());
+        std::atomic<size_t> next{0};
+        auto decode = [&]() {
+            for (size_t i; (i = next++) < files.size();) {
+                if (SDL_Surface* s = IMG_Load(files[i].second.c_str())) {
+                    images[i] = std::shared_ptr<SDL_Surface>(s, [](auto* s) { SDL_FreeSurface(s); });
+                }
+            }
+        };
+        std::vector<std::thread> decoders(std::min(std::max<size_t>(1, std::thread::hardware_concurrency()), files.size()));
+        for (auto& t : decoders) t = std::thread(decode);
+        for (auto& t : decoders) t.join();
+
+        std::vector<size_t> loaded;
+        std::vector<asset_region_c> placed;
+        for (size_t i = 0; i < files.size(); i++) {
+            if (!images[i]) continue;
+            loaded.push_back(i);
+            placed.push_back({0, 0, images[i]->w, images[i]->h});
+        }
+        width = atlas_width;
+        height = pack_shelves(placed, atlas_width);
+        regions.clear();
+        for (size_t k = 0; k < loaded.size(); k++) place(files[loaded[k]].first, placed[k]);
+
+        std::shared_ptr<SDL_Surface> atlas(SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_RGBA32),
+            [](auto* s) { SDL_FreeSurface(s); });
+        if (!atlas) throw std::runtime_error(SDL_GetError());
+        for (auto i : loaded) {
+            SDL_SetSurfaceBlendMode(images[i].get(), SDL_BLENDMODE_NONE);
+            SDL_Rect dst = regions[files[i].first];
+            SDL_BlitSurface(images[i].get(), NULL, atlas.get(), &dst);
+        }
+        upload(r, atlas->pixels, atlas->pitch);
+    }
+
+    /// sets the region of a sprite
+    void place(int handle, const asset_region_c& region)
+    {
+        if (handle >= (int)regions.size()) regions.resize(handle + 1, SDL_Rect{0, 0, 0, 0});
+        regions[handle] = {region.x, region.y, region.w, region.h};
+    }
+
+    /**
+     * creates the texture from atlas pixels already decoded and packed (RGBA32,
+     * width x height, pitch bytes per row) - a baked pack is uploaded from its
+     * mapped file this way, the regions are set with place()
+     * */
+    void upload(SDL_Renderer* r, const void* pixels, int pitch)
+    {
+        texture = std::shared_ptr<SDL_Texture>(SDL_CreateTexture(r, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STATIC, width, height),
+            [](auto* tex) { SDL_DestroyTexture(tex); });
+        if (!texture) throw std::runtime_error(SDL_GetError());
+        SDL_UpdateTexture(texture.get(), NULL, pixels, pitch);
+        SDL_SetTextureBlendMode(texture.get(), SDL_BLENDMODE_BLEND);
+    }
+
+    /// region of the sprite, empty for sprites which were not loaded
+    const SDL_Rect& at(int handle) const
+    {
+        static const SDL_Rect none = {0, 0, 0, 0};
+        return ((unsigned)handle < regions.size()) ? regions[handle] : none;
+    }
+};
+
+/**
+ * textured quads collected during the frame and submitted with one SDL_RenderGeometry call
+ * */
+class sprite_batch_c
+{
+public:
+    std::vector<SDL_Vertex> vertices;
+    std::vector<int> indices;
+    SDL_Texture* texture = nullptr;
+    int atlas_width = 1;
+    int atlas_height = 1;
+
+    /// starts a new frame of sprites from the atlas
+    void begin(const sprite_atlas_c& atlas)
+    {
+        vertices.clear();
+        indices.clear();
+        texture = atlas.texture.get();
+        atlas_width = atlas.width;
+        atlas_height = atlas.height;
+    }
+
+    /**
+     * the region src of the atlas drawn at dst, rotated by angle degrees clockwise
+     * around the center of dst (like SDL_RenderCopyEx)
+     * */
+    void add(const SDL_Rect& src, const SDL_Rect& dst, double angle = 0.0, bool flip = false, SDL_Color color = {255, 255, 255, 255})
+    {
+        float u0 = (float)src.x / atlas_width, u1 = (float)(src.x + src.w) / atlas_width;
+        float v0 = (float)src.y / atlas_height, v1 = (float)(src.y + src.h) / atlas_height;
+        if (flip) std::swap(u0, u1);
+
+        float cx = dst.x + dst.w * 0.5f, cy = dst.y + dst.h * 0.5f;
+        float hw = dst.w * 0.5f, hh = dst.h * 0.5f;
+        float c = 1.0f, s = 0.0f;
+        if (angle != 0.0) {
+            c = (float)std::cos(angle * M_PI / 180.0);
+            s = (float)std::sin(angle * M_PI / 180.0);
+        }
+        const float corners[4][4] = {{-hw, -hh, u0, v0}, {hw, -hh, u1, v0}, {hw, hh, u1, v1}, {-hw, hh, u0, v1}};
+        int first = vertices.size();
+        for (auto& k : corners) {
+            SDL_Vertex vertex;
+            vertex.position = {cx + k[0] * c - k[1] * s, cy + k[0] * s + k[1] * c};
+            vertex.color = color;
+            vertex.tex_coord = {k[2], k[3]};
+            vertices.push_back(vertex);
+        }
+        for (int i : {0, 1, 2, 0, 2, 3}) indices.push_back(first + i);
+    }
+
+    /// quads already laid out (4 vertices each, in add() order), moved by dx, dy
+    void add_quads(const std::vector<SDL_Vertex>& quads, float dx, float dy)
+    {
+        int first = vertices.size();
+        for (auto vertex : quads) {
+            vertex.position.x += dx;
+            vertex.position.y += dy;
+            vertices.push_back(vertex);
+        }
+        for (int q = first; q < (int)vertices.size(); q += 4) {
+            for (int i : {0, 1, 2, 0, 2, 3}) indices.push_back(q + i);
+        }
+    }
+
+    void draw(SDL_Renderer* r)
+    {
+        if (indices.empty()) return;
+        SDL_RenderGeometry(r, texture, vertices.data(), vertices.size(), indices.data(), indices.size());
+    }
+};
+
+/**
+ * target texture which static content is rendered into once and then copied every frame.
+ * The layer remembers the version of the content it holds, so it is rendered again
+ * only when that changes or when the renderer loses its targets.
+ * */
+class render_layer_c
+{
+public:
+    std::shared_ptr<SDL_Texture> texture;
+    uint64_t version = 0;
+    bool valid = false;
+
+    bool stale(uint64_t content_version) const { return !valid || content_version != version; }
+    void invalidate() { valid = false; }
+
+    /// redirects rendering into the layer (created on first use) and clears it
+    void begin(SDL_Renderer* r, int w, int h)
+    {
+        if (!texture) {
+            texture = std::shared_ptr<SDL_Texture>(SDL_CreateTexture(r, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_TARGET, w, h),
+                [](auto* tex) { SDL_DestroyTexture(tex); });
+            SDL_SetTextureBlendMode(texture.get(), SDL_BLENDMODE_BLEND);
+        }
+        SDL_SetRenderTarget(r, texture.get());
+        SDL_SetRenderDrawColor(r, 0, 0, 0, 0);
+        SDL_RenderClear(r);
+    }
+
+    void end(SDL_Renderer* r, uint64_t content_version)
+    {
+        SDL_SetRenderTarget(r, NULL);
+        version = content_version;
+        valid = true;
+    }
+
+    void draw(SDL_Renderer* r, const SDL_Rect& dst)
+    {
+        SDL_RenderCopy(r, texture.get(), NULL, &dst);
+    }
+};
+
+} // namespace tp
+#endif
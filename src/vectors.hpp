@@ -41,5 +41,53 @@ inline double length(const T& a) {
 
 }; // namespace tp
 
+namespace tp {
+
+/// sqrt(x * x + y * y), 0 for the zero vector
+template <typename T>
+inline T norm(T x, T y)
+{
+    T ret = x * x + y * y;
+    return (ret == 0) ? T(0) : std::sqrt(ret);
+}
+
+/**
+ * 2d vector of any scalar type (double, float, fixed_c). The operators are
+ * evaluated in the same order as the ones of tp::operators on std::array, so
+ * with double the results are the same.
+ * */
+template <typename T>
+class vec2_c
+{
+public:
+    T v[2];
+
+    vec2_c() = default;
+    constexpr vec2_c(T x, T y) : v{x, y} {}
+
+    static constexpr unsigned size() { return 2; }
+    constexpr T& operator[](unsigned i) { return v[i]; }
+    constexpr const T& operator[](unsigned i) const { return v[i]; }
+    constexpr T* data() { return v; }
+    constexpr const T* data() const { return v; }
+
+    friend constexpr vec2_c operator+(const vec2_c& a, const vec2_c& b) { return {a[0] + b[0], a[1] + b[1]}; }
+    friend constexpr vec2_c operator-(const vec2_c& a, const vec2_c& b) { return {a[0] - b[0], a[1] - b[1]}; }
+    friend constexpr vec2_c operator*(const vec2_c& a, const vec2_c& b) { return {a[0] * b[0], a[1] * b[1]}; }
+    friend constexpr vec2_c operator*(const vec2_c& a, T b) { return {a[0] * b, a[1] * b}; }
+    friend constexpr vec2_c& operator+=(vec2_c& a, const vec2_c& b) { return a = a + b; }
+    friend constexpr vec2_c& operator-=(vec2_c& a, const vec2_c& b) { return a = a - b; }
+    friend constexpr bool operator==(const vec2_c& a, const vec2_c& b) { return (a[0] == b[0]) && (a[1] == b[1]); }
+    friend constexpr bool operator!=(const vec2_c& a, const vec2_c& b) { return !(a == b); }
+
+    friend T length(const vec2_c& a)
+    {
+        using tp::norm;
+        return norm(a[0], a[1]);
+    }
+};
+
+} // namespace tp
+
 
 #endif
@@ -0,0 +1,117 @@
+#ifndef ___VIEW_FOR_BULLETHELL_HPP__
+#define ___VIEW_FOR_BULLETHELL_HPP__
+
+#include "world.hpp"
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+/**
+ * what the renderer needs to know about the world after one tick
+ * */
+class world_view_c
+{
+public:
+    class player_view_c
+    {
+    public:
+        std::array<double, 2> position;
+        double health;
+        bool crouching;
+        int gun_angle;
+        bool last_move_left;
+    };
+
+    uint64_t tick = 0;
+    /// when the tick is due on the simulation clock
+    std::chrono::steady_clock::time_point time;
+
+    std::vector<player_view_c> players;
+    /// bullets are in the order of the pool, so their ids are ascending
+    std::vector<uint32_t> bullet_id;
+    std::vector<std::array<double, 2>> bullet_position;
+    std::vector<uint16_t> bullet_type;
+
+    std::shared_ptr<const std::vector<obstacle_c>> obstacles;
+    uint64_t obstacles_version = 0;
+
+    /// obstacles are shared between views, they are only copied when their version changes
+    void capture(const world_c& game, uint64_t tick_, std::chrono::steady_clock::time_point time_,
+        const std::shared_ptr<const std::vector<obstacle_c>>& obstacles_)
+    {
+        tick = tick_;
+        time = time_;
+        players.resize(game.players.size());
+        for (unsigned i = 0; i < game.players.size(); i++) {
+            auto& p = game.players[i];
+            players[i] = {to_double(p.position), double(p.health), p.crouching, p.gun_angle, p.last_move_left};
+        }
+        bullet_id.assign(game.bullets.id.begin(), game.bullets.id.end());
+        bullet_position.resize(game.bullets.size());
+        for (size_t i = 0; i < game.bullets.size(); i++) bullet_position[i] = to_double(game.bullets.position[i]);
+        bullet_type.assign(game.bullets.type.begin(), game.bullets.type.end());
+        obstacles = obstacles_;
+        obstacles_version = game.obstacles_version;
+    }
+};
+
+/**
+ * hands views from the simulation thread to the render thread.
+ *
+ * The simulation captures every tick into a free buffer and publishes it, the
+ * renderer takes the two latest views. A buffer is never reused while it is
+ * published or being drawn, so neither side waits for the other except for
+ * swapping a few indices.
+ * */
+class view_exchange_c
+{
+public:
+    /// simulation thread: buffer for the next view
+    world_view_c& begin_write()
+    {
+        std::lock_guard<std::mutex> lock(m);
+        for (int i = 0; i < (int)views.size(); i++) {
+            if (i != previous && i != latest && i != reading_previous && i != reading_latest) {
+                writing = i;
+                break;
+            }
+        }
+        return views[writing];
+    }
+
+    /// simulation thread: the view from begin_write becomes the latest one
+    void publish()
+    {
+        std::lock_guard<std::mutex> lock(m);
+        previous = latest;
+        latest = writing;
+    }
+
+    /**
+     * render thread: previous and latest published views (nullptr until there are
+     * enough of them). They stay untouched until the next acquire.
+     * */
+    std::pair<const world_view_c*, const world_view_c*> acquire()
+    {
+        std::lock_guard<std::mutex> lock(m);
+        reading_previous = previous;
+        reading_latest = latest;
+        return {(previous < 0) ? nullptr : &views[previous], (latest < 0) ? nullptr : &views[latest]};
+    }
+
+private:
+    std::mutex m;
+    // at most four are in use at any time - two published and two being drawn
+    std::array<world_view_c, 5> views;
+    int writing = 0;
+    int previous = -1;
+    int latest = -1;
+    int reading_previous = -1;
+    int reading_latest = -1;
+};
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef ___WORK_POOL_FOR_BULLETHELL_HPP__
+#define ___WORK_POOL_FOR_BULLETHELL_HPP__
+
+#include "parallel.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * threads running many independent tasks (whole simulations), with work stealing.
+ *
+ * The tasks are dealt round robin into one deque per thread. A thread takes its
+ * own tasks from the back and, when it has none left, steals from the front of
+ * the others - threads which got long tasks (worlds full of bullets) are helped
+ * by the ones which finished early, without a shared queue every task goes
+ * through.
+ *
+ * Each task runs on one thread only, the OpenMP loops inside the simulation are
+ * limited to a single thread, so the tasks do not compete for the cores.
+ * */
+class work_pool_c
+{
+public:
+    explicit work_pool_c(int threads_ = std::max(1u, std::thread::hardware_concurrency())) : threads(std::max(1, threads_)) {}
+
+    int size() const { return threads; }
+
+    /// tasks which were run by another thread than the one they were dealt to, in the last run
+    size_t steals() const { return stolen.load(); }
+
+    /**
+     * calls task(i, thread) for every i in [0, n), returns when all of them are done.
+     * thread is the index of the thread, so tasks can reuse per thread memory.
+     * */
+    template <typename F>
+    void run(size_t n, F task)
+    {
+        queues.clear();
+        for (int t = 0; t < threads; t++) queues.push_back(std::make_unique<queue_c>());
+        for (size_t i = 0; i < n; i++) queues[i % threads]->tasks.push_back(i);
+        stolen = 0;
+
+        auto worker = [&](int t) {
+            tp::limit_threads(1);
+            size_t i;
+            while (take(t, i)) task(i, t);
+        };
+        // the calling thread is one of the workers, it gets its limit back afterwards
+        int caller_threads = tp::max_threads();
+        std::vector<std::thread> workers;
+        for (int t = 1; t < threads; t++) workers.emplace_back(worker, t);
+        worker(0);
+        for (auto& w : workers) w.join();
+        tp::limit_threads(caller_threads);
+    }
+
+private:
+    class alignas(64) queue_c
+    {
+    public:
+        std::mutex m;
+        std::deque<size_t> tasks;
+    };
+
+    int threads;
+    std::vector<std::unique_ptr<queue_c>> queues;
+    std::atomic<size_t> stolen{0};
+
+    // no new tasks appear during a run, so when every queue is empty the thread is done
+    bool take(int t, size_t& i)
+    {
+        {
+            auto& q = *queues[t];
+            std::lock_guard<std::mutex> lock(q.m);
+            if (!q.tasks.empty()) {
+                i = q.tasks.back();
+                q.tasks.pop_back();
+                return true;
+            }
+        }
+        for (int k = 1; k < threads; k++) {
+            auto& q = *queues[(t + k) % threads];
+            std::lock_guard<std::mutex> lock(q.m);
+            if (!q.tasks.empty()) {
+                i = q.tasks.front();
+                q.tasks.pop_front();
+                stolen++;
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+#endif
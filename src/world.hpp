@@ -0,0 +1,839 @@
+#ifndef ___WORLD_FOR_BULLETHELL_HPP__
+#define ___WORLD_FOR_BULLETHELL_HPP__
+
+#include "arena.hpp"
+#include "integrate.hpp"
+#include "parallel.hpp"
+#include "patterns.hpp"
+#include "precision.hpp"
+#include "vectors.hpp"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * interned names - every distinct name gets a small integer id, so entities can
+ * refer to sprites without storing strings
+ * */
+class name_table_c
+{
+public:
+    std::vector<std::string> names;
+
+    uint16_t id(const std::string& name)
+    {
+        int i = find(name);
+        if (i >= 0) return i;
+        names.push_back(name);
+        return names.size() - 1;
+    }
+
+    /// id of the name, -1 if it is not interned
+    int find(const std::string& name) const
+    {
+        for (unsigned i = 0; i < names.size(); i++) {
+            if (names[i] == name) return i;
+        }
+        return -1;
+    }
+
+    size_t size() const { return names.size(); }
+};
+
+/**
+ * the physics classes are templates over the scalar (see precision.hpp), the
+ * world uses them with real_t
+ * */
+template <typename T>
+class basic_physical_c
+{
+public:
+    tp::vec2_c<T> position;
+    tp::vec2_c<T> velocity;
+    tp::vec2_c<T> acceleration;
+    T friction;
+
+    // basic physics
+    void update(T dt_f)
+    {
+        auto new_acceleration = acceleration - velocity * length(velocity) * friction;
+        auto new_velocity = velocity + new_acceleration * dt_f;
+        auto new_position = position + new_velocity * dt_f + new_acceleration * dt_f * dt_f * 0.5;
+        position = new_position;
+        velocity = new_velocity;
+        acceleration = new_acceleration;
+    }
+};
+using physical_c = basic_physical_c<real_t>;
+
+enum bullet_flags_e : uint8_t {
+    BULLET_DAMAGES_PLAYER = 1,
+    BULLET_BLOCKED_BY_OBSTACLES = 2,
+    BULLET_DESTROYED_ON_CONTACT = 4,
+    BULLET_EXPIRED = 8
+};
+
+/**
+ * description of a single bullet, used to spawn it into bullet_pool_c
+ * */
+template <typename T>
+class basic_bullet_c : public basic_physical_c<T>
+{
+public:
+    uint16_t type = 0; // sprite id
+    uint8_t program = 0; // bullet program in pattern_library_c
+    bool damages_player = false;
+    bool blocked_by_obstacles = false;
+    bool destroyed_on_contact = false;
+    bool expired = false;
+    T time = 0.2;
+};
+using bullet_c = basic_bullet_c<real_t>;
+
+/**
+ * all the bullets in the game, stored as structure of arrays
+ *
+ * bullets are never copied as a whole, the pool keeps the capacity of its arrays,
+ * so spawning and removing does not allocate once the pool has grown
+ * */
+class bullet_pool_c
+{
+public:
+    std::vector<vec2_t> position;
+    std::vector<vec2_t> previous_position;
+    std::vector<vec2_t> velocity;
+    std::vector<vec2_t> acceleration;
+    std::vector<real_t> friction;
+    std::vector<real_t> time;
+    std::vector<uint16_t> type;
+    std::vector<uint8_t> program;
+    std::vector<uint8_t> flags;
+    /// unique for every bullet ever spawned, ascending within every group of the pool (see compact)
+    std::vector<uint32_t> id;
+    uint32_t next_id = 0;
+
+    size_t size() const { return position.size(); }
+    bool empty() const { return position.empty(); }
+
+    void reserve(size_t n)
+    {
+        position.reserve(n);
+        previous_position.reserve(n);
+        velocity.reserve(n);
+        acceleration.reserve(n);
+        friction.reserve(n);
+        time.reserve(n);
+        type.reserve(n);
+        program.reserve(n);
+        flags.reserve(n);
+        id.reserve(n);
+    }
+
+    void clear() { resize(0); }
+
+    void push_back(const bullet_c& b)
+    {
+        position.push_back(b.position);
+        previous_position.push_back(b.position);
+        velocity.push_back(b.velocity);
+        acceleration.push_back(b.acceleration);
+        friction.push_back(b.friction);
+        time.push_back(b.time);
+        type.push_back(b.type);
+        program.push_back(b.program);
+        flags.push_back((b.damages_player ? BULLET_DAMAGES_PLAYER : 0) |
+                        (b.blocked_by_obstacles ? BULLET_BLOCKED_BY_OBSTACLES : 0) |
+                        (b.destroyed_on_contact ? BULLET_DESTROYED_ON_CONTACT : 0) |
+                        (b.expired ? BULLET_EXPIRED : 0));
+        id.push_back(next_id++);
+    }
+
+    /// n copies of b at the end of the pool, returns the index of the first one
+    size_t spawn(const bullet_c& b, size_t n)
+    {
+        size_t first = size();
+        position.insert(position.end(), n, b.position);
+        previous_position.insert(previous_position.end(), n, b.position);
+        velocity.insert(velocity.end(), n, b.velocity);
+        acceleration.insert(acceleration.end(), n, b.acceleration);
+        friction.insert(friction.end(), n, b.friction);
+        time.insert(time.end(), n, b.time);
+        type.insert(type.end(), n, b.type);
+        program.insert(program.end(), n, b.program);
+        flags.insert(flags.end(), n, (b.damages_player ? BULLET_DAMAGES_PLAYER : 0) |
+                                         (b.blocked_by_obstacles ? BULLET_BLOCKED_BY_OBSTACLES : 0) |
+                                         (b.destroyed_on_contact ? BULLET_DESTROYED_ON_CONTACT : 0) |
+                                         (b.expired ? BULLET_EXPIRED : 0));
+        for (size_t i = 0; i < n; i++) id.push_back(next_id++);
+        return first;
+    }
+
+    /// kernel group of bullet i - its program, with or without friction
+    unsigned group(size_t i) const { return 2u * program[i] + (friction[i] != 0); }
+    static constexpr size_t group_count = 2 * 256;
+
+    /**
+     * stream compaction - keeps the bullets for which keep(i) returns true, sorted
+     * by group and otherwise in their order. keep(i) may modify bullet i before it
+     * is moved, but not its group.
+     *
+     * So after a compaction the bullets of a group are contiguous and their ids
+     * ascending; only bullets spawned since are at the end, in any group. The
+     * update moves each group as one range.
+     *
+     * Large pools are split into chunks counted and moved in parallel. When the
+     * pool is sorted already, the kept bullets are moved together in place, each
+     * chunk within its own range and then the chunks in order. Otherwise they are
+     * scattered to the offsets of their groups in a second buffer, which then
+     * becomes the pool. keep(i) has to be safe to call from several threads (for
+     * different i).
+     * */
+    template <typename F>
+    void compact(F keep)
+    {
+        size_t n = size();
+        int chunks = tp::chunk_count(n);
+        chunk_offsets.assign(chunks * group_count, 0);
+        chunk_sorted.resize(chunks);
+        kept.resize(n);
+#pragma omp parallel for schedule(static, 1) num_threads(chunks) if (chunks > 1)
+        for (int c = 0; c < chunks; c++) {
+            size_t begin = tp::chunk_begin(n, c, chunks), end = tp::chunk_begin(n, c + 1, chunks);
+            size_t* count = chunk_offsets.data() + c * group_count;
+            bool sorted = true;
+            for (size_t r = begin; r < end; r++) {
+                kept[r] = keep(r);
+                if (kept[r]) count[group(r)]++;
+                if (r > begin && group(r) < group(r - 1)) sorted = false;
+            }
+            chunk_sorted[c] = sorted;
+        }
+        bool sorted = true;
+        for (int c = 0; c < chunks; c++) {
+            size_t begin = tp::chunk_begin(n, c, chunks);
+            if (!chunk_sorted[c] || (c > 0 && group(begin) < group(begin - 1))) sorted = false;
+        }
+        if (sorted) {
+            compact_in_place(chunks);
+            return;
+        }
+
+        // groups one after another, the chunks in order within a group
+        size_t w = 0;
+        for (size_t g = 0; g < group_count; g++) {
+            for (int c = 0; c < chunks; c++) {
+                size_t& offset = chunk_offsets[c * group_count + g];
+                size_t count = offset;
+                offset = w;
+                w += count;
+            }
+        }
+        bullet_pool_c& to = spare.get();
+        to.resize(w);
+#pragma omp parallel for schedule(static, 1) num_threads(chunks) if (chunks > 1)
+        for (int c = 0; c < chunks; c++) {
+            size_t begin = tp::chunk_begin(n, c, chunks), end = tp::chunk_begin(n, c + 1, chunks);
+            size_t* offset = chunk_offsets.data() + c * group_count;
+            for (size_t r = begin; r < end; r++) {
+                if (kept[r]) copy(to, r, offset[group(r)]++);
+            }
+        }
+        swap_arrays(to);
+    }
+
+    // bullet programs and basic physics for every bullet, remembers previous positions
+    void update(real_t dt_f, const pattern_library_c& patterns)
+    {
+        size_t n = size();
+        int chunks = tp::chunk_count(n);
+#pragma omp parallel for schedule(static, 1) num_threads(chunks) if (chunks > 1)
+        for (int c = 0; c < chunks; c++) {
+            size_t begin = tp::chunk_begin(n, c, chunks), end = tp::chunk_begin(n, c + 1, chunks);
+            update_range(begin, end, dt_f, patterns);
+        }
+    }
+
+private:
+    /**
+     * the second buffer of compact(), not part of the state - copies of the pool
+     * (worlds, rollback frames) do not get it
+     * */
+    class spare_c
+    {
+    public:
+        spare_c() = default;
+        spare_c(const spare_c&) {}
+        spare_c& operator=(const spare_c&) { return *this; }
+
+        bullet_pool_c& get()
+        {
+            if (!pool) pool = std::make_unique<bullet_pool_c>();
+            return *pool;
+        }
+
+    private:
+        std::unique_ptr<bullet_pool_c> pool;
+    };
+
+    // for every chunk, the kept bullets of every group and then where they go
+    std::vector<size_t> chunk_offsets;
+    std::vector<uint8_t> chunk_sorted;
+    std::vector<uint8_t> kept;
+    spare_c spare;
+
+    // the second half of compact() for a sorted pool, which stays sorted
+    void compact_in_place(int chunks)
+    {
+        size_t n = size();
+        chunk_offsets.resize(chunks);
+#pragma omp parallel for schedule(static, 1) num_threads(chunks) if (chunks > 1)
+        for (int c = 0; c < chunks; c++) {
+            size_t begin = tp::chunk_begin(n, c, chunks), end = tp::chunk_begin(n, c + 1, chunks);
+            size_t w = begin;
+            for (size_t r = begin; r < end; r++) {
+                if (!kept[r]) continue;
+                if (w != r) copy(*this, r, w);
+                w++;
+            }
+            chunk_offsets[c] = w - begin;
+        }
+        size_t w = chunk_offsets[0];
+        for (int c = 1; c < chunks; c++) {
+            size_t begin = tp::chunk_begin(n, c, chunks);
+            for (size_t r = begin; r < begin + chunk_offsets[c]; r++, w++) copy(*this, r, w);
+        }
+        resize(w);
+    }
+
+    using kernel_f = void (bullet_pool_c::*)(size_t, size_t, const pattern_program_c&, real_t);
+
+    // every kernel, indexed by its features
+    template <size_t... K>
+    static constexpr std::array<kernel_f, sizeof...(K)> make_kernels(std::index_sequence<K...>)
+    {
+        return {&bullet_pool_c::kernel<K>...};
+    }
+
+    void update_range(size_t begin, size_t end, real_t dt_f, const pattern_library_c& patterns)
+    {
+        static constexpr std::array<kernel_f, KERNEL_COUNT> kernels = make_kernels(std::make_index_sequence<KERNEL_COUNT>());
+
+        std::copy(position.begin() + begin, position.begin() + end, previous_position.begin() + begin);
+
+        // runs of bullets of the same group, every run is moved by one kernel
+        size_t programs = patterns.bullets.size();
+        for (size_t run_end, i = begin; i < end; i = run_end) {
+            unsigned g = group(i);
+            for (run_end = i + 1; run_end < end && group(run_end) == g;) run_end++;
+            if (program[i] >= programs) continue;
+            auto& p = patterns.bullets[program[i]];
+            unsigned drag = (g % 2) ? KERNEL_DRAG : 0;
+            if (p.has_kernel) {
+                kernel_f kernel = kernels[p.kernel | drag];
+                (this->*kernel)(i, run_end, p, dt_f);
+            }
+            else {
+                // the VM runs op by op, the kernel without features only integrates
+                kernel_f integrate = kernels[drag];
+                run(p.ops.data(), p.ops.data() + p.integrate_at, i, run_end, dt_f);
+                (this->*integrate)(i, run_end, p, dt_f);
+                run(p.ops.data() + p.integrate_at + 1, p.ops.data() + p.ops.size(), i, run_end, dt_f);
+            }
+        }
+    }
+
+    /**
+     * a bullet program with bullet_kernel_e features K, over the bullets [begin, end):
+     * the ops before the integration, tp::integrate (SSE2/AVX2 with double precision)
+     * and the clamp, each one loop. The integration is the same as physical_c::update,
+     * without the drag term when the bullets have no friction.
+     * */
+    template <unsigned K>
+    void kernel(size_t begin, size_t end, const pattern_program_c& p, real_t dt_f)
+    {
+        if constexpr (bool(K & (KERNEL_ACCEL | KERNEL_OSCILLATE | KERNEL_TIME | KERNEL_EXPIRE))) {
+            for (size_t i = begin; i < end; i++) kernel_before<K>(i, p, dt_f);
+        }
+        tp::integrate(position.data() + begin, velocity.data() + begin, acceleration.data() + begin,
+            bool(K & KERNEL_DRAG) ? friction.data() + begin : nullptr, end - begin, dt_f);
+        if constexpr (bool(K & KERNEL_CLAMP)) {
+            for (size_t i = begin; i < end; i++) kernel_clamp(position[i], p);
+        }
+    }
+
+    // the features of a kernel which come before the integration
+    template <unsigned K>
+    void kernel_before(size_t i, const pattern_program_c& p, real_t dt_f)
+    {
+        if constexpr (bool(K & KERNEL_ACCEL)) acceleration[i] = p.accel;
+        if constexpr (bool(K & KERNEL_OSCILLATE)) {
+            acceleration[i] = (time[i] > p.accel_after) ? p.accel_after_value : acceleration[i];
+            time[i] = (time[i] > p.wrap_time) ? real_t(0) : time[i];
+        }
+        if constexpr (bool(K & KERNEL_TIME)) time[i] += dt_f;
+        if constexpr (bool(K & KERNEL_EXPIRE)) flags[i] |= (time[i] > p.expire_after) ? BULLET_EXPIRED : 0;
+    }
+
+    static void kernel_clamp(vec2_t& position, const pattern_program_c& p)
+    {
+        for (int a = 0; a < 2; a++) {
+            position[a] = (position[a] < p.clamp_min[a]) ? p.clamp_min[a] : position[a];
+            position[a] = (position[a] > p.clamp_max[a]) ? p.clamp_max[a] : position[a];
+        }
+    }
+
+    /// the bullet program VM - one loop over the bullets [begin, end) for every op
+    void run(const pattern_op_c* op, const pattern_op_c* ops_end, size_t begin, size_t end, real_t dt_f)
+    {
+        for (; op < ops_end; op++) {
+            switch (op->op) {
+            case OP_SET_ACCEL:
+                for (size_t i = begin; i < end; i++) acceleration[i] = {op->a, op->b};
+                break;
+            case OP_SET_ACCEL_AFTER:
+                for (size_t i = begin; i < end; i++) {
+                    if (time[i] > op->a) acceleration[i] = {op->b, op->c};
+                }
+                break;
+            case OP_WRAP_TIME:
+                for (size_t i = begin; i < end; i++) {
+                    if (time[i] > op->a) time[i] = 0;
+                }
+                break;
+            case OP_ADVANCE_TIME:
+                for (size_t i = begin; i < end; i++) time[i] += dt_f;
+                break;
+            case OP_EXPIRE_AFTER:
+                for (size_t i = begin; i < end; i++) {
+                    if (time[i] > op->a) flags[i] |= BULLET_EXPIRED;
+                }
+                break;
+            case OP_CLAMP_X:
+                for (size_t i = begin; i < end; i++) {
+                    if (position[i][0] < op->a) position[i][0] = op->a;
+                    if (position[i][0] > op->b) position[i][0] = op->b;
+                }
+                break;
+            case OP_CLAMP_Y:
+                for (size_t i = begin; i < end; i++) {
+                    if (position[i][1] < op->a) position[i][1] = op->a;
+                    if (position[i][1] > op->b) position[i][1] = op->b;
+                }
+                break;
+            default:
+                break;
+            }
+        }
+    }
+
+    void copy(bullet_pool_c& to, size_t from, size_t at) const
+    {
+        to.position[at] = position[from];
+        to.previous_position[at] = previous_position[from];
+        to.velocity[at] = velocity[from];
+        to.acceleration[at] = acceleration[from];
+        to.friction[at] = friction[from];
+        to.time[at] = time[from];
+        to.type[at] = type[from];
+        to.program[at] = program[from];
+        to.flags[at] = flags[from];
+        to.id[at] = id[from];
+    }
+
+    void swap_arrays(bullet_pool_c& other)
+    {
+        position.swap(other.position);
+        previous_position.swap(other.previous_position);
+        velocity.swap(other.velocity);
+        acceleration.swap(other.acceleration);
+        friction.swap(other.friction);
+        time.swap(other.time);
+        type.swap(other.type);
+        program.swap(other.program);
+        flags.swap(other.flags);
+        id.swap(other.id);
+    }
+
+    void resize(size_t n)
+    {
+        position.resize(n);
+        previous_position.resize(n);
+        velocity.resize(n);
+        acceleration.resize(n);
+        friction.resize(n);
+        time.resize(n);
+        type.resize(n);
+        program.resize(n);
+        flags.resize(n);
+        id.resize(n);
+    }
+};
+
+template <typename T>
+class basic_emitter_c : public basic_physical_c<T>
+{
+public:
+    T emit_to_emit;
+    T emit_delay;
+    uint16_t pattern = 0; // emitter program in pattern_library_c
+    T angle = 0;          // turned by OP_SPIN
+};
+using emitter_c = basic_emitter_c<real_t>;
+
+/**
+ * what a player wants to do during the tick, one bit each
+ * */
+enum intent_e : uint32_t {
+    INTENT_RIGHT = 1 << 0,
+    INTENT_LEFT = 1 << 1,
+    INTENT_UP = 1 << 2,
+    INTENT_DOWN = 1 << 3,
+    INTENT_GUN_UP = 1 << 4,
+    INTENT_GUN_DOWN = 1 << 5,
+    INTENT_SHOOT = 1 << 6,
+    INTENT_WARP_TOP = 1 << 7,
+    INTENT_WARP_SPAWN = 1 << 8,
+};
+constexpr int INTENT_COUNT = 9;
+
+/// names for configuration, in the order of the bits
+inline const std::array<const char*, INTENT_COUNT> intent_names = {
+    "right", "left", "up", "down", "gun_up", "gun_down", "shoot", "warp_top", "warp_spawn"};
+
+template <typename T>
+class basic_player_c : public basic_physical_c<T>
+{
+public:
+    using basic_physical_c<T>::position;
+    using basic_physical_c<T>::velocity;
+    using basic_physical_c<T>::acceleration;
+    using basic_physical_c<T>::friction;
+
+    uint32_t intentions = 0; // intent_e bits
+
+    T health;
+    T points;
+    T max_hspeed;
+    T jump_time = 0.25;
+    bool jump_available = true;
+    T jump_time_left = jump_time;
+    bool crouching = false;
+    int gun_angle = 0;
+    bool last_move_left = false;
+    bool on_ground = false;
+    uint32_t hits_taken = 0; // bullets which hit the player, for statistics
+
+    basic_player_c(tp::vec2_c<T> position_ = {10, 10}, tp::vec2_c<T> velocity_ = {0, 0}, tp::vec2_c<T> acceleration_ = {0, 0}, T friction_ = 0.03,
+             T max_hspeed_ = 15)
+    {
+        position = position_;
+        velocity = velocity_;
+        acceleration = acceleration_;
+        friction = friction_;
+        max_hspeed = max_hspeed_;
+
+        health = 100;
+        points = 0;
+    }
+
+    void apply_intent()
+    {
+
+    }
+
+    void update(T dt_f)
+    {
+        //apply_intent();
+
+        if (intentions & INTENT_GUN_UP) gun_angle = std::min(70, gun_angle + 2);
+        if (intentions & INTENT_GUN_DOWN) gun_angle = std::max(-10, gun_angle - 2);
+
+        acceleration = {0, 50};
+        if (intentions & INTENT_RIGHT) {
+            acceleration[0] += 100;
+            last_move_left = false;
+        }
+
+        if (intentions & INTENT_LEFT) {
+            acceleration[0] += -100;
+            last_move_left = true;
+        }
+
+        if (intentions & INTENT_DOWN) {
+            if (!crouching) {
+                position[1] += 0.35;
+            }
+            crouching = true;
+        }
+        else {
+            if (crouching && on_ground) position[1] -= 0.6;
+            crouching = false;
+        }
+
+        if (on_ground) {
+            jump_available = true;
+            jump_time_left = jump_time;
+        }
+        else if (!(intentions & INTENT_UP)) jump_available = false;
+
+        if ((intentions & INTENT_UP) && jump_available) {
+            acceleration[1] += -170;
+            jump_time_left -= dt_f;
+            if (jump_time_left <= 0) jump_available = false;
+        }
+
+        bool breaking = (on_ground && !(intentions & INTENT_LEFT) && !(intentions & INTENT_RIGHT));
+        tp::vec2_c<T> new_acceleration;
+        if (breaking) {
+            if (velocity[0] * velocity[0] > 10)
+                new_acceleration = acceleration - velocity * length(velocity) * friction * 10;
+            else
+                new_acceleration = acceleration - velocity * length(velocity) * friction * 40;
+        }
+        else {
+            new_acceleration = acceleration - velocity * length(velocity) * friction;
+        }
+        auto new_velocity = velocity + new_acceleration * dt_f;
+        auto new_position = position + new_velocity * dt_f + new_acceleration * dt_f * dt_f * 0.5;
+        position = new_position;
+        velocity = new_velocity;
+        if (velocity[0] < -max_hspeed) velocity[0] = -max_hspeed;
+        if (velocity[0] > max_hspeed) velocity[0] = max_hspeed;
+        if (breaking) {
+            velocity = {(velocity[0] * velocity[0] > 2.5) ? velocity[0] : T(0), 0};
+        }
+        acceleration = new_acceleration;
+        intentions = 0;
+        on_ground = false;
+    }
+
+//     bool is_safe_place()
+//     {
+//         return false;
+//         return ((position[0] < 4.0) && (position[1] > 30) && (position[0] > 0.0) && (position[1] < 33));
+//     }
+};
+using player_c = basic_player_c<real_t>;
+
+class obstacle_c {
+public:
+    vec2_t position;
+    vec2_t size;
+    uint16_t texture; // sprite id
+};
+
+/**
+ * uniform grid of unit cells over the obstacles, each cell lists the obstacles
+ * touching it. The lists are stored back to back (cell_start points into items).
+ * */
+class obstacle_grid_c
+{
+public:
+    int x0 = 0;
+    int y0 = 0;
+    int width = 0;
+    int height = 0;
+    std::vector<uint32_t> cell_start;
+    std::vector<uint32_t> items;
+
+    void build(const std::vector<obstacle_c>& obstacles)
+    {
+        if (obstacles.empty()) {
+            width = height = 0;
+            cell_start.assign(1, 0);
+            items.clear();
+            return;
+        }
+        int x1 = x0 = (int)std::floor(double(obstacles[0].position[0]));
+        int y1 = y0 = (int)std::floor(double(obstacles[0].position[1]));
+        for (auto& o : obstacles) {
+            x0 = std::min(x0, (int)std::floor(double(o.position[0])));
+            y0 = std::min(y0, (int)std::floor(double(o.position[1])));
+            x1 = std::max(x1, (int)std::floor(double(o.position[0] + o.size[0])));
+            y1 = std::max(y1, (int)std::floor(double(o.position[1] + o.size[1])));
+        }
+        width = x1 - x0 + 1;
+        height = y1 - y0 + 1;
+
+        // count, prefix sum, fill - obstacles are visited in order, so every cell list is sorted
+        cell_start.assign(width * height + 1, 0);
+        for (auto& o : obstacles) {
+            for_cells(o, [&](int c) { cell_start[c + 1]++; });
+        }
+        for (int c = 0; c < width * height; c++) cell_start[c + 1] += cell_start[c];
+        items.resize(cell_start.back());
+        std::vector<uint32_t> fill(cell_start.begin(), cell_start.end() - 1);
+        for (uint32_t i = 0; i < obstacles.size(); i++) {
+            for_cells(obstacles[i], [&](int c) { items[fill[c]++] = i; });
+        }
+    }
+
+    /**
+     * indices of the obstacles which may touch the box, ascending and without duplicates.
+     * The result is stored in found, so the caller can reuse its memory.
+     * */
+    void query(real_t min_x, real_t min_y, real_t max_x, real_t max_y, std::vector<uint32_t>& found) const
+    {
+        found.clear();
+        int cx0 = cell(min_x, x0, width);
+        int cy0 = cell(min_y, y0, height);
+        int cx1 = cell(max_x, x0, width);
+        int cy1 = cell(max_y, y0, height);
+        if (cx0 == width || cy0 == height || cx1 < 0 || cy1 < 0) return;
+        cx0 = std::max(cx0, 0);
+        cy0 = std::max(cy0, 0);
+        cx1 = std::min(cx1, width - 1);
+        cy1 = std::min(cy1, height - 1);
+        for (int y = cy0; y <= cy1; y++) {
+            for (int x = cx0; x <= cx1; x++) {
+                int c = y * width + x;
+                found.insert(found.end(), items.begin() + cell_start[c], items.begin() + cell_start[c + 1]);
+            }
+        }
+        std::sort(found.begin(), found.end());
+        found.erase(std::unique(found.begin(), found.end()), found.end());
+    }
+
+private:
+    // cell coordinate clamped to [-1, n], so far away entities do not overflow
+    static int cell(real_t v, int origin, int n)
+    {
+        return (int)std::clamp(std::floor(double(v)) - origin, -1.0, (double)n);
+    }
+
+    // obstacle boxes are closed, so an edge lying on the cell border belongs to both cells
+    template <typename F>
+    void for_cells(const obstacle_c& o, F f) const
+    {
+        int cx0 = (int)std::floor(double(o.position[0])) - x0;
+        int cy0 = (int)std::floor(double(o.position[1])) - y0;
+        int cx1 = (int)std::floor(double(o.position[0] + o.size[0])) - x0;
+        int cy1 = (int)std::floor(double(o.position[1] + o.size[1])) - y0;
+        for (int y = cy0; y <= cy1; y++) {
+            for (int x = cx0; x <= cx1; x++) {
+                f(y * width + x);
+            }
+        }
+    }
+};
+
+/**
+ * spatial hash of points (bullet positions), rebuilt every time it is needed.
+ * Like in obstacle_grid_c, bucket lists are stored back to back and sorted.
+ * */
+class spatial_hash_c
+{
+public:
+    double cell_size = 1.3;
+    std::vector<uint32_t> bucket_start;
+    std::vector<uint32_t> items;
+
+    /// inserts points i for which (flags[i] & required) != 0
+    void build(const std::vector<vec2_t>& points, const std::vector<uint8_t>& flags, uint8_t required)
+    {
+        uint32_t n = 16;
+        while (n < points.size()) n *= 2;
+        mask = n - 1;
+
+        // hashing is the expensive part, it runs in parallel; counting sort is done in order
+        size_t count = points.size();
+        point_bucket.resize(count);
+        int chunks = tp::chunk_count(count);
+#pragma omp parallel for schedule(static, 1) num_threads(chunks) if (chunks > 1)
+        for (int c = 0; c < chunks; c++) {
+            for (size_t i = tp::chunk_begin(count, c, chunks); i < tp::chunk_begin(count, c + 1, chunks); i++) {
+                point_bucket[i] = (flags[i] & required) ? bucket(points[i]) : n;
+            }
+        }
+
+        bucket_start.assign(n + 2, 0);
+        for (auto b : point_bucket) bucket_start[b + 1]++;
+        for (uint32_t b = 0; b < n; b++) bucket_start[b + 1] += bucket_start[b];
+        bucket_start.pop_back();
+        items.resize(bucket_start.back());
+        fill.assign(bucket_start.begin(), bucket_start.end() - 1);
+        for (uint32_t i = 0; i < count; i++) {
+            if (point_bucket[i] != n) items[fill[point_bucket[i]]++] = i;
+        }
+    }
+
+    /**
+     * indices of the points which may be closer than cell_size to p, ascending and
+     * without duplicates (different cells can share a bucket)
+     * */
+    void query(const vec2_t& p, std::vector<uint32_t>& found) const
+    {
+        found.clear();
+        int64_t cx = cell(p[0]);
+        int64_t cy = cell(p[1]);
+        for (int64_t y = cy - 1; y <= cy + 1; y++) {
+            for (int64_t x = cx - 1; x <= cx + 1; x++) {
+                uint32_t b = hash(x, y);
+                found.insert(found.end(), items.begin() + bucket_start[b], items.begin() + bucket_start[b + 1]);
+            }
+        }
+        std::sort(found.begin(), found.end());
+        found.erase(std::unique(found.begin(), found.end()), found.end());
+    }
+
+private:
+    uint32_t mask = 0;
+    std::vector<uint32_t> fill;
+    std::vector<uint32_t> point_bucket;
+
+    int64_t cell(real_t v) const { return (int64_t)std::floor(double(v) / cell_size); }
+    uint32_t hash(int64_t x, int64_t y) const { return ((uint64_t)x * 73856093u ^ (uint64_t)y * 19349663u) & mask; }
+    uint32_t bucket(const vec2_t& p) const { return hash(cell(p[0]), cell(p[1])); }
+};
+
+/**
+ * memory the simulation phases reuse every tick instead of allocating it
+ * */
+class tick_scratch_c
+{
+public:
+    /// fixed size arrays, reset at the start of every phase
+    frame_arena_c arena;
+    /// results of obstacle and bullet lookups, one list per thread
+    std::vector<std::vector<uint32_t>> found;
+    /// bullets which hit each player
+    std::vector<std::vector<uint32_t>> hits;
+};
+
+/**
+ * simulation state of the game, without anything related to the display
+ * */
+class world_c
+{
+public:
+    name_table_c sprites;
+    std::vector<player_c> players;
+    bullet_pool_c bullets;
+    std::vector<emitter_c> emitters;
+    pattern_library_c patterns;
+    /// emitter program of the players' guns
+    uint16_t gun_pattern = 0;
+
+    std::vector<obstacle_c> obstacles;
+    obstacle_grid_c obstacle_grid;
+    uint64_t obstacles_version = 0;
+    spatial_hash_c bullet_hash;
+    tick_scratch_c scratch;
+
+    std::chrono::milliseconds dt;
+
+    /// has to be called after obstacles change - rebuilds the grid and bumps the version
+    void obstacles_changed()
+    {
+        obstacle_grid.build(obstacles);
+        obstacles_version++;
+    }
+};
+
+#endif